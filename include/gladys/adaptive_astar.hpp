@@ -0,0 +1,78 @@
+/*
+ * adaptive_astar.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-18
+ * license: BSD
+ */
+#ifndef ADAPTIVE_ASTAR_HPP
+#define ADAPTIVE_ASTAR_HPP
+
+#include <ctime>
+#include <vector>
+
+#include "gladys/graph_astar.hpp"
+
+namespace gladys {
+
+/*
+ * Adaptive A* towards a fixed goal, for an executive which plans again from
+ * a start moving along the previous path.
+ *
+ * After each search, every expanded vertex s learns h(s) = g(goal) - g(s),
+ * which remains admissible and is more informed than the euclidean
+ * distance, so the following searches expand fewer vertices. See 'Adaptive
+ * A*' (Koenig & Likhachev, AAMAS 2005).
+ *
+ * Weight increases keep the learnt values admissible. To cope with weight
+ * decreases, the edges modified since the previous search (edge::t, as in
+ * dstar_search) are used to lower the learnt values until they are
+ * consistent again, as in 'Generalized Adaptive A*' (Sun, Koenig & Yeoh,
+ * AAMAS 2008).
+ */
+class adaptive_astar {
+    const graph_t& g;
+    vertex_t goal;
+    time_t t; // start time of the previous search
+    std::vector<double> h_values; // < 0 : not learnt yet (euclidean)
+    double cost;
+    size_t expanded;
+
+    void restore_consistency();
+
+public:
+    adaptive_astar(const graph_t& g, const vertex_t& goal);
+
+    /** search a path from start to the goal
+     *
+     * @returns the path, empty if the goal is not reachable.
+     */
+    path_t search(const vertex_t& start);
+
+    /** heuristic value of v (learnt or euclidean distance to the goal) */
+    double h(const vertex_t& v) const {
+        if (h_values[v] < 0)
+            return distance(g[v].pt, g[goal].pt);
+        return h_values[v];
+    }
+
+    /** cost of the last path found (+inf if none) */
+    double get_cost() const {
+        return cost;
+    }
+
+    /** number of vertices expanded by the last search */
+    size_t get_expanded() const {
+        return expanded;
+    }
+
+    const vertex_t& get_goal() const {
+        return goal;
+    }
+};
+
+} // namespace gladys
+
+#endif // ADAPTIVE_ASTAR_HPP
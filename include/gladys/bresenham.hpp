@@ -11,10 +11,117 @@
 #ifndef BRESENHAM_HPP
 #define BRESENHAM_HPP
 
+#include <cstdlib> // abs
+#include <utility> // swap
+
 #include "gladys/point.hpp"
 
 namespace gladys {
 
+/** Walk the Bresenham's line between cells (x0, y0) and (x1, y1)
+ *
+ * Calls visit(x, y) for each cell of the line, both ends included, from
+ * (x0, y0) to (x1, y1). Nothing is allocated, and the walk stops as soon
+ * as visit returns false.
+ *
+ * @param visit callable as bool visit(int x, int y)
+ *
+ * @returns false if the walk was stopped by visit, true otherwise.
+ *
+ */
+template <class Visitor>
+bool bresenham_walk(int x0, int y0, int x1, int y1, Visitor visit) {
+    bool steep = ( std::abs(y1 - y0) > std::abs(x1 - x0) ) ;
+    if ( steep ) {
+        std::swap(x0, y0) ;
+        std::swap(x1, y1) ;
+    }
+
+    int deltax = std::abs(x1 - x0) ;
+    int deltay = std::abs(y1 - y0) ;
+    int error = deltax / 2 ;
+    int y = y0 ;
+    int xstep = ( x0 < x1 ? 1 : -1 );
+    int ystep = ( y0 < y1 ? 1 : -1 );
+
+    for ( int x = x0 ; ; x += xstep ) {
+        if ( !( steep ? visit(y, x) : visit(x, y) ) )
+            return false ;
+        if ( x == x1 )
+            return true ;
+        // progression control
+        error -= deltay ;
+        if ( error < 0 ) {
+            y += ystep ;
+            error += deltax ;
+        }
+    }
+}
+
+/** Bresenham's line between cells (x0, y0) and (x1, y1), step by step
+ *
+ * the same cells as bresenham_walk, with jumps: the state after n steps
+ * is computed in O(1), so that a walk can skip the cells of a box.
+ */
+class bresenham_line {
+    bool steep;
+    long u, v, u1;      // major and minor coordinates, last major one
+    long du, dv, error; // error in [0, du)
+    long ustep, vstep;
+
+public:
+    bresenham_line(long x0, long y0, long x1, long y1) {
+        steep = ( std::abs(y1 - y0) > std::abs(x1 - x0) ) ;
+        if ( steep ) {
+            std::swap(x0, y0) ;
+            std::swap(x1, y1) ;
+        }
+        u = x0; v = y0; u1 = x1;
+        du = std::abs(x1 - x0) ;
+        dv = std::abs(y1 - y0) ;
+        error = du / 2 ;
+        ustep = ( x0 < x1 ? 1 : -1 );
+        vstep = ( y0 < y1 ? 1 : -1 );
+    }
+
+    long x() const {
+        return steep ? v : u;
+    }
+    long y() const {
+        return steep ? u : v;
+    }
+    /** steps left up to the last cell */
+    long remaining() const {
+        return std::abs(u1 - u);
+    }
+
+    /** advance n steps, n <= remaining() */
+    void advance(long n) {
+        u += n * ustep;
+        error -= n * dv;
+        if ( error < 0 ) {
+            long k = (du - 1 - error) / du; // minor steps, error back in [0, du)
+            v += k * vstep;
+            error += k * du;
+        }
+    }
+
+    /** steps before leaving the box [x0, x1] x [y0, y1] holding the cell */
+    long steps_in(long x0, long y0, long x1, long y1) const {
+        if ( steep ) {
+            std::swap(x0, y0) ;
+            std::swap(x1, y1) ;
+        }
+        long n = ( ustep > 0 ? x1 - u : u - x0 ) + 1;
+        if ( dv > 0 ) {
+            // the minor coordinate leaves after m minor steps, k(n) >= m
+            long m = ( vstep > 0 ? y1 - v : v - y0 ) + 1;
+            n = std::min(n, ((m - 1) * du + error) / dv + 1);
+        }
+        return n;
+    }
+};
+
 /** Compute the Bresenham's line between s and t
  *
  * The implementation keeps the order of the points in the line (from s to t)
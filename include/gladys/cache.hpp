@@ -11,6 +11,7 @@
 #define CACHE_HPP
 
 #include <list> 
+#include <cassert>
 #include <functional>
 
 namespace gladys {
@@ -103,6 +104,26 @@ namespace gladys {
                 }
             } 
 
+            /** look k up without calling fn: true and its value if cached */
+            bool find(const key_type& k, value_type& v)
+            {
+                const auto it = key_to_value.find(k);
+                if (it == key_to_value.end())
+                    return false;
+                key_tracker.splice(key_tracker.end(),
+                                   key_tracker,
+                                   it->second.second);
+                v = it->second.first;
+                return true;
+            }
+
+            /** record v = fn(k) computed by the caller, e.g. outside a lock */
+            void store(const key_type& k, const value_type& v)
+            {
+                if (key_to_value.find(k) == key_to_value.end())
+                    insert(k, v);
+            }
+
             void invalidate() 
             {
                 key_tracker.clear();
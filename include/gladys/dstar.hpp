@@ -11,6 +11,12 @@
 #ifndef DSTAR_HPP
 #define DSTAR_HPP 
 
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
 #include <boost/bimap/bimap.hpp>
 #include <boost/bimap/unordered_set_of.hpp>
 #include <boost/bimap/multiset_of.hpp>
@@ -21,6 +27,26 @@ namespace gladys {
 
     class no_path {};
 
+    /*
+     * Bounds for onboard use of dstar_search.
+     *
+     * When sparse is set, g and rhs are only stored for the vertices touched
+     * by the search (in a hash table) instead of a vector sized for the whole
+     * graph. max_expansions and max_duration (in seconds) bound the work done
+     * by a single call to the search (constructor or replan); 0 means
+     * unlimited.
+     */
+    struct dstar_limits {
+        bool sparse;
+        size_t max_expansions;
+        double max_duration;
+
+        dstar_limits(bool sparse = false, size_t max_expansions = 0,
+                     double max_duration = 0) :
+            sparse(sparse), max_expansions(max_expansions),
+            max_duration(max_duration) {}
+    };
+
     class dstar_search {
         /*
          * This is a fairly trivial implementation of dstar lite as described
@@ -44,6 +70,11 @@ namespace gladys {
          * euclidean distance between two vertices.
          * XXX: the replan part is not well tested, as the API does not allow
          * to upgrade a graph.
+         *
+         * With dstar_limits, the search may stop before start is consistent.
+         * In that case is_complete() returns false, get_path() returns a
+         * best-effort path, and the next replan() resumes the search where
+         * it stopped.
          */
         private:
 
@@ -61,12 +92,57 @@ namespace gladys {
                 float rhs;
             };
 
+            /*
+             * g and rhs storage, either dense (one entry per vertex of the
+             * graph) or sparse (only the touched vertices). Untouched
+             * vertices read as {inf, inf}.
+             */
+            class cost_table {
+                std::vector<cost> dense;
+                std::unordered_map<vertex_t, cost> sparse;
+                bool is_sparse;
+                static const cost unknown;
+
+            public:
+                cost_table(size_t size, bool is_sparse);
+
+                const cost& get(const vertex_t& v) const {
+                    if (!is_sparse)
+                        return dense[v];
+                    auto it = sparse.find(v);
+                    return it == sparse.end() ? unknown : it->second;
+                }
+                cost& operator[](const vertex_t& v) {
+                    if (!is_sparse)
+                        return dense[v];
+                    return sparse.insert(std::make_pair(v, unknown)).first->second;
+                }
+                /** number of stored entries */
+                size_t size() const {
+                    return is_sparse ? sparse.size() : dense.size();
+                }
+                /** call f(vertex, cost) for every touched vertex */
+                template <class F>
+                void for_each(F f) const {
+                    if (is_sparse) {
+                        for (const auto& kv : sparse)
+                            f(kv.first, kv.second);
+                        return;
+                    }
+                    for (size_t v = 0; v < dense.size(); v++)
+                        if (dense[v].g != unknown.g or dense[v].rhs != unknown.rhs)
+                            f(v, dense[v]);
+                }
+            };
+
             const graph_t& g;
             vertex_t start, goal, last;
             time_t t;
             bm_type pq;
-            std::vector<cost> costs;
+            dstar_limits limits;
+            cost_table costs;
             float km;
+            bool complete;
 
             key_t calc_key(const vertex_t& v) const;
 
@@ -74,17 +150,68 @@ namespace gladys {
 
             void update_vertex(const vertex_t& v);
             void compute_shortest_path();
+
+            path_t get_best_effort_path() const;
             
             void print_pq() const;
 
         public:
-            dstar_search(const graph_t& g, const vertex_t& start, const vertex_t& goal);
+            dstar_search(const graph_t& g, const vertex_t& start, const vertex_t& goal,
+                         const dstar_limits& limits = dstar_limits());
+
+            /** resume a search from a snapshot written by save()
+             *
+             * No search is run: the state is restored as it was saved, and the
+             * next replan() continues incrementally.
+             *
+             * @throws std::runtime_error if the snapshot is invalid or was
+             * taken on a different graph (see graph_version).
+             */
+            dstar_search(const graph_t& g, std::istream& is,
+                         const dstar_limits& limits = dstar_limits());
+            dstar_search(const graph_t& g, const std::string& filepath,
+                         const dstar_limits& limits = dstar_limits());
+
+            /** write a compact binary snapshot of the search state
+             *
+             * Holds g and rhs of the touched vertices, km, last, the time of
+             * the last update and the priority queue, keyed to the
+             * graph_version. Numbers are written in native byte order.
+             */
+            void save(std::ostream& os) const;
+            void save(const std::string& filepath) const;
+
+            /** fingerprint of the graph structure (vertices and edges)
+             *
+             * Edge weights are not part of it: weight changes made after a
+             * snapshot are picked by replan() through the edge timestamps.
+             */
+            static uint64_t graph_version(const graph_t& g);
 
             void write_graphviz(std::ostream& os) const;
 
+            /** path from the current position to the goal
+             *
+             * If the last search ran out of budget, returns a best-effort path
+             * greedily following the g values computed so far (it may stop
+             * before the goal).
+             *
+             * @throws no_path if the search is complete and the goal is not
+             * reachable.
+             */
             path_t get_path() const;
 
             void replan(const vertex_t& now);
+
+            /** false if the last search ran out of its budget */
+            bool is_complete() const {
+                return complete;
+            }
+
+            /** number of vertices holding g and rhs values */
+            size_t get_touched() const {
+                return costs.size();
+            }
     };
 
 
@@ -17,6 +17,7 @@
 
 #include "gladys/point.hpp"
 #include "gladys/nav_graph.hpp"
+#include "gladys/pixel_transform.hpp"
 
 // NOTE : it currently work only with 2D points
 
@@ -65,7 +66,6 @@ private:
     const nav_graph& ng ;           // use for its weight_map and
                                     // the path planning
     const weight_map& map ;         // the weightmap linked with the nav graph
-    const gdalwrap::raster& data ;  // the gdal raster of the weightmap
 
     std::vector< points_t > frontiers ;         // the list of the frontiers
     std::vector< f_attributes > attributes ;    // the frontiers attributes
@@ -89,6 +89,10 @@ private:
     double x_max ;
     double y_min ; 
     double y_max ;
+    // the focused area in pixels (inclusive bounds) and the map transform
+    long px_min, px_max, py_min, py_max ;
+    pixel_transform pixels ;
+    std::vector< size_t > frontier_neighbours ; // used by is_frontier
 
     /* hidden computing functions */
     /** compute_frontiers_WFD
@@ -127,25 +131,24 @@ private:
 
     /** is_frontier
      *
-     * Tell if the given point is a frontier point.
+     * Tell if the given pixel is a frontier point.
      *
-     * @param p : the point which is tested.
+     * @param idx : the index (x + y * width) of the pixel which is tested.
      *
      */
-    bool is_frontier(  const point_xy_t &p ) ;
+    bool is_frontier( size_t idx ) ;
 
     /** find_neighbours()
      *
-     * Return the list of adjacent points (or neighbours) of p
+     * Fill neighbours with the indices of the adjacent pixels of idx,
+     * within the focused area.
      *
-     * @param p : the point we focus.
+     * @param idx : the index (x + y * width) of the pixel we focus.
      *
-     * @param height : the height of the map.
+     * @param neighbours : the output list (cleared first).
      *
-     * @param width : the height of the map.
-     * 
      */
-     points_t find_neighbours( const point_xy_t &p ); 
+    void find_neighbours( size_t idx, std::vector<size_t>& neighbours ); 
 
 public:
     /* Name of the available algorithms to compute frontiers */
@@ -161,8 +164,7 @@ public:
                        double _height_max,
                        double _width_max ) :
             ng (_ng),
-            map ( ng.get_map() ),
-            data ( map.get_weight_band() )
+            map ( ng.get_map() )
 
 
 
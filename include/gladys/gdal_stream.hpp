@@ -0,0 +1,83 @@
+/*
+ * gdal_stream.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef GDAL_STREAM_HPP
+#define GDAL_STREAM_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "gdalwrap/gdal.hpp"
+
+class GDALDataset;
+
+namespace gladys {
+
+/*
+ * read a (multi-layers) GeoTiff by blocks of rows,
+ * without loading all its bands in memory
+ */
+class gdal_stream {
+    GDALDataset* dataset;
+    std::vector<std::string> names;
+    size_t width, height;
+    size_t block_rows;
+
+    gdal_stream(const gdal_stream&); // non copyable
+    void operator=(const gdal_stream&);
+
+    /** read rows [row_begin, row_end) of the given bands in buffers */
+    void read(const std::vector<size_t>& band_ids, size_t row_begin,
+              size_t row_end, std::vector<gdalwrap::raster>& buffers) const;
+
+public:
+    /** open a GeoTiff (only its meta-data are read)
+     *
+     * @param filepath path to the file
+     * @param rows number of rows per block, 0 to fit the file blocks
+     * (strips or tiles) with at least 64 rows.
+     */
+    gdal_stream(const std::string& filepath, size_t rows = 0);
+    ~gdal_stream();
+
+    const std::vector<std::string>& get_names() const {
+        return names;
+    }
+    size_t get_band_id(const std::string& name) const;
+    size_t get_width() const {
+        return width;
+    }
+    size_t get_height() const {
+        return height;
+    }
+    size_t get_block_rows() const {
+        return block_rows;
+    }
+
+    /** set the meta-data (size, transform, origins) of dst
+     * with n empty bands of the size of this file
+     */
+    void copy_meta(gdalwrap::gdal& dst, size_t n) const;
+
+    typedef std::function<void(size_t row_begin, size_t row_end,
+        const std::vector<const float*>& bands)> block_fn;
+
+    /** read the given bands block by block
+     *
+     * fn(row_begin, row_end, bands) is called on each block in order,
+     * bands[i] pointing to the rows of band_ids[i]; the next block is read
+     * while fn processes the current one. Only two blocks are in memory.
+     */
+    void for_each_block(const std::vector<size_t>& band_ids, block_fn fn) const;
+};
+
+} // namespace gladys
+
+#endif // GDAL_STREAM_HPP
@@ -36,6 +36,13 @@ typedef std::pair<point_xy_t, float> points_prob_t;
 typedef std::vector<points_prob_t>   points_probs_t;
 typedef struct {} behaviour_t;
 
+typedef struct {
+    size_t size;                    // number of points
+    std::vector<bool> links;        // links[i * size + j], symmetric
+    std::vector<size_t> component;  // connected component of each point
+    size_t n_components;
+} comm_links_t;
+
 /*
  * gladys
  */
@@ -43,6 +50,7 @@ class gladys {
     weight_map w_map;
     nav_graph navigation_graph;
     visibility_map visibility;
+    bool horizons_conservative = true;
 public:
     /** gladys constructor
      *
@@ -86,6 +94,10 @@ public:
     points_probs_t can_see(const point_xy_t& locA, const points_t& llocB) const;
     points_t is_visible_from(const point_xy_t& locA, const points_t& llocB,
         float qmin) const;
+    // true if a point of llocB is visible (is_visible) from one of llocA,
+    // with a link quality 1 - d / sensor range of at least qmin, d being
+    // the distance from the sensor to the target. Pairs are culled on a
+    // grid of the range then tested nearest first, in parallel.
     bool test_visibility_link(const points_t& llocA, const points_t& llocB,
         float qmin) const;
     double look_at(int sensor, const points_t& observe) const;
@@ -93,6 +105,45 @@ public:
     //uses position and range of the antenna defined in the robot model
     bool can_communicate(const point_xy_t& locA, const point_xy_t& locB) const;
     bool can_communicate(const point_xyz_t& locA, const point_xyz_t& locB) const;
+    // can_communicate both ways between the centers of the cells of locA
+    // and locB: the waypoints snapped to their cells, the same pairs of
+    // cells hit the visibility cache (see enable_visibility_cache)
+    bool can_communicate_cell(const point_xy_t& locA, const point_xy_t& locB) const;
+    /** communication links among robots and relay points
+     *
+     * can_communicate is not symmetric: the antenna is the one of its
+     * first point, the second is on the ground. Two points are linked if
+     * each one's antenna sees the other, can_communicate both ways.
+     * Pairs out of antenna range are culled on a grid of the range, the
+     * others are tested in parallel.
+     *
+     * @param locs the positions of the robots and relays
+     *
+     * @returns the symmetric adjacency matrix, and its connected components
+     * (component ids from 0 to n_components - 1)
+     */
+    comm_links_t communication_links(const points_t& locs) const;
+    // precompute the antenna horizons, can_communicate (2D) then tests
+    // the links with visibility_map::is_antenna_visible_approx: the links
+    // certified by the upper horizon in O(1), the others exactly if
+    // conservative, else approximately in O(1) (with the lower map)
+    void build_horizons(size_t sectors = 32, size_t rings = 1,
+                        bool conservative = true) {
+        visibility.build_horizons(sectors, rings, !conservative);
+        horizons_conservative = conservative;
+    }
+    void load_horizons(const std::string& filepath, bool conservative = true) {
+        visibility.load_horizons(filepath);
+        horizons_conservative = conservative;
+    }
+    // memoise the line-of-sight tests of can_communicate_cell, and of
+    // visibility_map::is_visible_cell (see visibility_map::enable_cache)
+    void enable_visibility_cache(size_t capacity) {
+        visibility.enable_cache(capacity);
+    }
+    void disable_visibility_cache() {
+        visibility.disable_cache();
+    }
 
     point_xy_t get_closest_point(const point_xy_t& pt){
         return navigation_graph.get_closest_point_custom(pt);
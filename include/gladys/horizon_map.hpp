@@ -0,0 +1,231 @@
+/*
+ * horizon_map.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef HORIZON_MAP_HPP
+#define HORIZON_MAP_HPP
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "gdalwrap/gdal.hpp"
+#include "gladys/packed_dtm.hpp"
+#include "gladys/pixel_transform.hpp"
+#include "gladys/parallel.hpp"
+
+namespace gladys {
+
+/*
+ * horizons of every cell, per azimuth sector and distance ring
+ *
+ * for a sensor at height 'sensor_z' above a cell, the slopes
+ * (z - zs - eps) / d of the known cells in range, d being the horizontal
+ * distance to the sensor. K sectors split the azimuth, R rings the range;
+ * ring j holds the maximum over the cells up to (j + 1) / R of the range.
+ * Two maps:
+ *  - upper: a bound of the slope for a sensor anywhere in its cell, a cell
+ *    counting in every sector its footprint overlaps. Every cell of a
+ *    Bresenham line is bounded: a target above it is visible.
+ *  - lower, optional: the slope from the cell center, a cell counting in
+ *    the sector of its center only. A target below the lower horizon of
+ *    the rings before it is most likely hidden, the occluder being in its
+ *    sector but maybe not on its line.
+ * Footprint: R * K floats per cell for the upper map, as much again for
+ * the lower one. A single ring and no lower map (K floats per cell) is
+ * enough to certify visible targets; more rings tighten the bound of the
+ * nearer targets, the lower map answers for the hidden ones.
+ */
+class horizon_map {
+    std::vector<float> upper, lower; // [cell][ring][sector]
+    size_t width, height, sectors, rings;
+    double scale_x, scale_y; // absolute, in meters
+    double sensor_z, range;
+
+    /** sector of the angle (radians), as a real number */
+    double sector_at(double angle) const {
+        return (angle + M_PI) / (2 * M_PI) * sectors;
+    }
+    /** half diagonal of a cell: a sensor is within r of its cell center,
+     * a Bresenham cell within r of the line between two cell centers
+     */
+    double half_diagonal() const {
+        return 0.5 * std::sqrt(scale_x * scale_x + scale_y * scale_y);
+    }
+    /** distance covered by the rings (cell centers) */
+    double reach() const {
+        return range + 3 * half_diagonal();
+    }
+    /** distance between cell centers (dx, dy) away, in pixels */
+    double distance(long dx, long dy) const {
+        double mx = dx * scale_x, my = dy * scale_y;
+        return std::sqrt(mx * mx + my * my);
+    }
+    /** ring up to which cells are in reach d */
+    size_t ring_at(double d) const {
+        size_t j = std::ceil(d / reach() * rings);
+        return j > 0 ? std::min(j, rings) - 1 : 0;
+    }
+    size_t offset(size_t x, size_t y, size_t j, size_t k) const {
+        return ((x + y * width) * rings + j) * sectors + k;
+    }
+
+    /** a cell in reach around a cell, with the sectors it overlaps */
+    struct neighbour {
+        long dx, dy;
+        double d; // to the cell center
+        size_t j; // ring
+        long k, k0; // sector of the center, first sector overlapped
+        size_t count;
+    };
+    /** set the geometry, allocate the maps, return the stencil of build */
+    std::vector<neighbour> _prepare(const pixel_transform& pixels,
+            double _sensor_z, double _range, size_t _sectors, size_t _rings,
+            bool with_lower);
+
+public:
+    horizon_map() : width(0), height(0), sectors(0), rings(0), scale_x(1),
+        scale_y(1), sensor_z(0), range(0) {}
+
+    /** compute the horizons, rows in parallel
+     *
+     * @param cells Z_MAX and N_POINTS, cells(x, y) is a dtm_cell
+     * @param pixels the dtm transform
+     * @param sensor_z sensor height above the ground
+     * @param range sensor range (meters)
+     * @param sectors number of azimuth sectors
+     * @param rings number of distance rings
+     * @param with_lower also compute the lower map
+     * @param eps height margin of an occluder (see visibility_map)
+     */
+    template <class Cells>
+    void build(const Cells& cells, const pixel_transform& pixels,
+               double _sensor_z, double _range, size_t _sectors,
+               size_t _rings, bool with_lower, double eps);
+
+    /** sector of the direction (dx, dy), in pixels */
+    size_t sector(long dx, long dy) const {
+        size_t k = std::floor(sector_at(std::atan2(dy * scale_y, dx * scale_x)));
+        return k < sectors ? k : 0; // angle == pi
+    }
+
+    /** bound of the slopes of a line to the cell (dx, dy) away
+     * +inf if the sensor cell is unknown, -inf if nothing in range
+     */
+    float get_upper(size_t x, size_t y, long dx, long dy) const {
+        size_t j = ring_at(distance(dx, dy) + half_diagonal());
+        return upper[offset(x, y, j, sector(dx, dy))];
+    }
+
+    /** slopes of the sector before the cell (dx, dy) away
+     * -inf if no ring ends before it, or without lower map
+     */
+    float get_lower(size_t x, size_t y, long dx, long dy) const {
+        size_t j = std::floor(distance(dx, dy) / reach() * rings);
+        if (j == 0 or lower.empty())
+            return -std::numeric_limits<float>::infinity();
+        return lower[offset(x, y, std::min(j, rings) - 1, sector(dx, dy))];
+    }
+
+    /** one band per map, ring and sector, named HORIZON_<UP|LOW>_<j>_<k>,
+     * on the dtm geo meta-data
+     */
+    gdalwrap::gdal to_gdal(const gdalwrap::gdal& dtm) const;
+    /** read back a map written with to_gdal, for the same sensor */
+    void from_gdal(const gdalwrap::gdal& map, double sensor_z, double range);
+
+    bool empty() const {
+        return upper.empty();
+    }
+    bool has_lower() const {
+        return not lower.empty();
+    }
+    void clear() {
+        std::vector<float>().swap(upper);
+        std::vector<float>().swap(lower);
+        width = height = sectors = rings = 0;
+    }
+    size_t get_sectors() const {
+        return sectors;
+    }
+    size_t get_rings() const {
+        return rings;
+    }
+    double get_sensor_z() const {
+        return sensor_z;
+    }
+    double get_range() const {
+        return range;
+    }
+};
+
+template <class Cells>
+void horizon_map::build(const Cells& cells, const pixel_transform& pixels,
+        double _sensor_z, double _range, size_t _sectors, size_t _rings,
+        bool with_lower, double eps) {
+    const std::vector<neighbour> stencil = _prepare(pixels, _sensor_z,
+        _range, _sectors, _rings, with_lower);
+    const size_t size = rings * sectors;
+    const double r = half_diagonal();
+    const double inf = std::numeric_limits<double>::infinity();
+    parallel_for(0, height, [&](size_t row_begin, size_t row_end) {
+        std::vector<double> up(size), low(size);
+        for (size_t y = row_begin; y < row_end; y++)
+        for (size_t x = 0; x < width; x++) {
+            const dtm_cell c = cells(x, y);
+            if (c.n_points < 1 - eps)
+                continue; // unknown, no line of sight from there
+            double zs = c.z_max + sensor_z;
+            std::fill(up.begin(), up.end(), -inf);
+            std::fill(low.begin(), low.end(), -inf);
+            for (const neighbour& n : stencil) {
+                long px = x + n.dx, py = y + n.dy;
+                if (px < 0 or py < 0 or px >= long(width) or py >= long(height))
+                    continue;
+                const dtm_cell p = cells(px, py);
+                if (p.n_points < 1 - eps)
+                    continue; // see though it
+                double h = p.z_max - zs - eps;
+                if (with_lower and n.d > 0) {
+                    double& slope = low[n.j * sectors + n.k];
+                    slope = std::max(slope, h / n.d);
+                }
+                // the steepest over the distances to a sensor in the cell
+                double bound = h < 0   ? h / (n.d + r) :
+                               n.d > r ? h / (n.d - r) : inf;
+                double* ring = &up[n.j * sectors];
+                for (size_t i = 0; i < n.count; i++) {
+                    size_t k = (n.k0 + long(i) + long(sectors)) % sectors;
+                    ring[k] = std::max(ring[k], bound);
+                }
+            }
+            // a ring holds the inner rings too
+            for (size_t k = sectors; k < size; k++) {
+                up[k]  = std::max(up[k],  up[k - sectors]);
+                low[k] = std::max(low[k], low[k - sectors]);
+            }
+            size_t first = (x + y * width) * size;
+            for (size_t k = 0; k < size; k++) {
+                float& out = upper[first + k];
+                out = up[k]; // rounded up, a bound stays a bound
+                if (out < up[k])
+                    out = std::nextafter(out, float(inf));
+                if (with_lower)
+                    lower[first + k] = low[k];
+            }
+        }
+    }, 4);
+}
+
+} // namespace gladys
+
+#endif // HORIZON_MAP_HPP
@@ -0,0 +1,56 @@
+/*
+ * los_kernel.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef LOS_KERNEL_HPP
+#define LOS_KERNEL_HPP
+
+#include <string>
+#include <cstddef>
+
+namespace gladys {
+
+/** cells of a line of sight, tested 8 at a time
+ *
+ * dx, dy: offsets to the sensor (meters), z: Z_MAX, n: N_POINTS.
+ * Lanes past count are ignored; the kernels load them all the same, so
+ * they are zeroed, never left indeterminate.
+ */
+struct los_batch {
+    static const size_t size = 8;
+    double dx[size], dy[size];
+    float z[size], n[size];
+    size_t count;
+
+    los_batch() : dx(), dy(), z(), n(), count(0) {}
+};
+
+/** true if a known cell of the batch breaks the line of sight
+ *
+ * for each lane: the cell is unknown if n < n_min, and breaks the line
+ * if a*d + z - zs > eps, d = sqrt(dx*dx + dy*dy), a = (zs - zt) / d0
+ * being the one of the (s-t) line, as visibility_map::is_visible. All
+ * kernels compute in double with the same operations as the scalar one,
+ * no FMA: they return the same results bit for bit.
+ */
+typedef bool (*los_kernel_t)(const los_batch& batch, double zs, double a,
+                             double n_min, double eps);
+
+/** kernel by name: "scalar", "sse2" or "avx2"
+ *
+ * @returns NULL if not supported by this build or this CPU.
+ */
+los_kernel_t get_los_kernel(const std::string& name);
+
+/** the fastest kernel supported by this CPU, chosen once at run time */
+los_kernel_t get_los_kernel();
+const std::string& get_los_kernel_name();
+
+} // namespace gladys
+
+#endif // LOS_KERNEL_HPP
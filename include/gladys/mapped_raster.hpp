@@ -0,0 +1,92 @@
+/*
+ * mapped_raster.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef MAPPED_RASTER_HPP
+#define MAPPED_RASTER_HPP
+
+#include <string>
+#include <vector>
+
+#include "gdalwrap/gdal.hpp"
+
+namespace gladys {
+
+/*
+ * read-only float band in a tiled layout:
+ * square tiles of 2^shift pixels side, row-major inside a tile,
+ * tiles row-major in the band (partial tiles are padded).
+ */
+class tiled_raster {
+    const float* data;
+    size_t width, height;
+    size_t shift, mask, tiles_x;
+public:
+    tiled_raster(const float* _data, size_t _width, size_t _height,
+                 size_t _shift) : data(_data), width(_width),
+        height(_height), shift(_shift), mask((1 << _shift) - 1),
+        tiles_x((_width + mask) >> _shift) {}
+
+    float at(size_t x, size_t y) const {
+        size_t tile = (y >> shift) * tiles_x + (x >> shift);
+        return data[(((tile << shift) + (y & mask)) << shift) + (x & mask)];
+    }
+    /** same index as gdalwrap::raster (x + y * width) */
+    float operator[](size_t pos) const {
+        return at(pos % width, pos / width);
+    }
+    size_t size() const {
+        return width * height;
+    }
+};
+
+/*
+ * multi-layers raster file in a raw tiled layout, memory-mapped read-only
+ *
+ * the pages are shared between the processes mapping the same file,
+ * and only the tiles a query touches are read from disk.
+ */
+class mapped_raster {
+    void* addr;
+    size_t length;
+    gdalwrap::gdal meta; // geo meta-data only, no band
+    std::vector<std::string> names;
+    std::vector<tiled_raster> bands;
+
+    mapped_raster(const mapped_raster&); // non copyable
+    void operator=(const mapped_raster&);
+
+public:
+    /** map a file written by save() */
+    mapped_raster(const std::string& filepath);
+    ~mapped_raster();
+
+    /** write bands of a gdal in the tiled layout
+     *
+     * @param src the gdal (meta-data and bands)
+     * @param band_names names of the bands to write
+     * @param filepath output file
+     * @param shift tiles are 2^shift pixels side (default 64)
+     */
+    static void save(const gdalwrap::gdal& src,
+                     const std::vector<std::string>& band_names,
+                     const std::string& filepath, size_t shift = 6);
+
+    /** meta-data (size, transform, utm zone, custom origin) without band */
+    const gdalwrap::gdal& get_meta() const {
+        return meta;
+    }
+    const std::vector<std::string>& get_names() const {
+        return names;
+    }
+    const tiled_raster& get_band(const std::string& name) const;
+};
+
+} // namespace gladys
+
+#endif // MAPPED_RASTER_HPP
@@ -11,7 +11,9 @@
 #define NAV_GRAPH_HPP
 
 #include <string>
+#include <vector>
 #include <fstream> // output file stream
+#include <stdexcept>
 
 #include "gladys/point.hpp"
 #include "gladys/graph_astar.hpp"
@@ -30,6 +32,26 @@ class nav_graph {
     size_t height;
     double scale_x;
     double scale_y;
+    bool lazy_unknown;
+    std::vector<bool> pending; // unknown cells not built yet (lazy mode)
+    size_t n_pending;
+
+    void add_cell_edges(vertex_t vert_w, vertex_t vert_n, vertex_t vert_e,
+                        vertex_t vert_s, float weight, time_t t);
+    void expand_cell(size_t px_x, size_t px_y);
+
+    /** throw if cells are pending: a const search would miss them */
+    void check_expanded() const {
+        if (n_pending > 0)
+            throw std::logic_error("[nav_graph] lazy graph not expanded, "
+                                   "search it non-const or expand_all()");
+    }
+
+    // searches building the pending cells they reach (see nav_graph.cpp)
+    path_t _lazy_astar_search(const point_xy_t& start, const point_xy_t& goal);
+    path_cost_util_t _lazy_astar_search(const points_t& start, const points_t& goal);
+    detailed_path_t _lazy_detailed_astar_search(const point_xy_t& start,
+                                                const point_xy_t& goal);
 
     vertex_t get_vertex_or_create(double x, double y) {
         point_xy_t p = {x, y};
@@ -47,8 +69,18 @@ public:
     /** nav_graph constructor
      *
      * @param w_map single layers weight map
+     *
+     * @param lazy_unknown if true, the unknown cells (their vertices and
+     * edges) are not built at load time but when a search first reaches
+     * them (then kept). Memory and build time then scale with the known
+     * terrain. Only the non-const searches build them: the const ones, and
+     * get_graph() (so the planners working on a graph_t, as dstar_search
+     * and adaptive_astar) throw std::logic_error until expand_all() has
+     * built every cell. A non-const search modifies the graph: it must not
+     * run concurrently with any other use of it.
      */
-    nav_graph(const weight_map& w_map) : map(w_map) {
+    nav_graph(const weight_map& w_map, bool lazy_unknown = false) :
+        map(w_map), lazy_unknown(lazy_unknown), n_pending(0) {
         width   = map.get_width();
         height  = map.get_height();
         scale_x = map.get_scale_x();
@@ -57,6 +89,18 @@ public:
     }
     void _load();
 
+    /** build the pending unknown cells around v (lazy mode) */
+    void expand_vertex(const vertex_t& v);
+    /** build the pending unknown cells next to the cell of p, the closest
+     * vertex to p being on one of their sides (lazy mode) */
+    void expand_around(const point_xy_t& p);
+    /** build all the pending unknown cells (lazy mode) */
+    void expand_all();
+    /** false if unknown cells are pending (lazy mode) */
+    bool is_expanded() const {
+        return n_pending == 0;
+    }
+
     // vertices
     vertex_t new_vertex(const point_xy_t& p) {
         vertex_t v = boost::add_vertex(g);
@@ -69,6 +113,7 @@ public:
         return new_vertex(p);
     }
 
+    /** NOTE: in lazy mode, among the vertices built so far (see expand_around) */
     vertex_t get_closest_vertex(const point_xy_t& p) const {
         vertex_map_t::const_iterator it = vertices.find(p);
         if (it != vertices.end())
@@ -87,8 +132,12 @@ public:
         return closest_v;
     }
 
+    /* searches: the const ones throw on a lazy graph not expanded, the
+     * others build the unknown cells they reach (see nav_graph) */
     path_t astar_search(const point_xy_t& start, const point_xy_t& goal) const;
+    path_t astar_search(const point_xy_t& start, const point_xy_t& goal);
     path_cost_util_t astar_search(const points_t& start, const points_t& goal) const;
+    path_cost_util_t astar_search(const points_t& start, const points_t& goal);
     path_cost_util_t astar_search_custom(const points_t& start,
                                          const points_t& goal) const {
         // from custom frame to UTM and back to custom
@@ -97,14 +146,25 @@ public:
         pcu.path = utm_to_custom(pcu.path);
         return pcu;
     }
+    path_cost_util_t astar_search_custom(const points_t& start,
+                                         const points_t& goal) {
+        path_cost_util_t pcu = astar_search( custom_to_utm(start),
+                                             custom_to_utm(goal ) );
+        pcu.path = utm_to_custom(pcu.path);
+        return pcu;
+    }
 
+    /** NOTE: reaches every cell, in lazy mode all are built first */
     std::vector<double> single_source_all_costs(const point_xy_t& start, const points_t& goals);
 
     detailed_path_t detailed_astar_search(const point_xy_t& start, const point_xy_t& goal) const;
+    detailed_path_t detailed_astar_search(const point_xy_t& start, const point_xy_t& goal);
 
     // returns the closest point in the navigation graph
     point_xy_t get_closest_point_custom(const point_xy_t& pt){
-        return utm_to_custom(g[get_closest_vertex(custom_to_utm(pt))].pt);
+        point_xy_t p = custom_to_utm(pt);
+        expand_around(p);
+        return utm_to_custom(g[get_closest_vertex(p)].pt);
     }
 
     point_xy_t custom_to_utm(const point_xy_t& p) const {
@@ -143,7 +203,13 @@ public:
         return map;
     }
 
+   /** throw std::logic_error on a lazy graph not expanded */
    const graph_t& get_graph() const {
+       check_expanded();
+       return g;
+   }
+   /** the vertices and edges built so far (lazy mode) */
+   const graph_t& get_partial_graph() const {
        return g;
    }
 };
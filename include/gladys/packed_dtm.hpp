@@ -0,0 +1,97 @@
+/*
+ * packed_dtm.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef PACKED_DTM_HPP
+#define PACKED_DTM_HPP
+
+#include <vector>
+
+#include "gdalwrap/gdal.hpp"
+#include "gladys/mapped_raster.hpp"
+
+namespace gladys {
+
+/** the dtm values read by line-of-sight tests */
+struct dtm_cell {
+    float z_max;
+    float n_points;
+};
+
+/** memory-mapped Z_MAX and N_POINTS bands seen as cells */
+struct dtm_tiles {
+    const tiled_raster& z_max;
+    const tiled_raster& n_points;
+
+    dtm_cell operator()(size_t x, size_t y) const {
+        return dtm_cell{z_max.at(x, y), n_points.at(x, y)};
+    }
+};
+
+/*
+ * Z_MAX and N_POINTS interleaved in a single array of cells
+ *
+ * a cell visited by a line of sight costs a single cache line. Cells are
+ * in row-major order, or in Morton (Z-order) order within 16x16 blocks,
+ * blocks in row-major order: neighbours along any direction are then
+ * close in memory, for a padding of less than 16 rows and columns.
+ */
+class packed_dtm {
+    static const size_t block_shift = 4; // 16x16 blocks
+    std::vector<dtm_cell> cells;
+    size_t width, height;
+    size_t blocks_x; // blocks per row, 0 in row-major order
+
+    /** spread the 4 low bits of v on the even bits */
+    static size_t spread(size_t v) {
+        v = (v | (v << 2)) & 0x33;
+        v = (v | (v << 1)) & 0x55;
+        return v;
+    }
+
+public:
+    packed_dtm() : width(0), height(0), blocks_x(0) {}
+
+    /** interleave the bands, in Morton order if morton is set */
+    void pack(const gdalwrap::raster& z_max, const gdalwrap::raster& n_points,
+              size_t width, size_t height, bool morton = false);
+
+    /** copy the bands again in [x0, x1) x [y0, y1), after they changed */
+    void update(const gdalwrap::raster& z_max, const gdalwrap::raster& n_points,
+                size_t x0, size_t y0, size_t x1, size_t y1);
+
+    void clear() {
+        std::vector<dtm_cell>().swap(cells);
+        width = height = blocks_x = 0;
+    }
+
+    /** position of cell (x, y) in the array */
+    size_t pos(size_t x, size_t y) const {
+        if (blocks_x == 0)
+            return x + y * width;
+        const size_t mask = (size_t(1) << block_shift) - 1;
+        size_t block = (x >> block_shift) + (y >> block_shift) * blocks_x;
+        return (block << (2 * block_shift)) |
+               spread(x & mask) | (spread(y & mask) << 1);
+    }
+
+    const dtm_cell& operator()(size_t x, size_t y) const {
+        return cells[ pos(x, y) ];
+    }
+
+    bool is_morton() const {
+        return blocks_x != 0;
+    }
+    bool empty() const {
+        return cells.empty();
+    }
+};
+
+} // namespace gladys
+
+#endif // PACKED_DTM_HPP
@@ -0,0 +1,108 @@
+/*
+ * parallel.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-18
+ * license: BSD
+ */
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <vector>
+#include <exception>
+
+namespace gladys {
+
+/** number of threads used by parallel_for */
+inline size_t get_num_threads() {
+    size_t n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+/** split [begin, end) in contiguous chunks of at least min_chunk items,
+ * and call fn(chunk_begin, chunk_end) for each chunk in its own thread
+ * (the calling thread takes the last one).
+ *
+ * The first exception thrown by fn is rethrown once all threads joined.
+ */
+template <class F>
+void parallel_for(size_t begin, size_t end, F fn, size_t min_chunk = 1) {
+    if (end <= begin)
+        return;
+    size_t size = end - begin;
+    if (min_chunk < 1)
+        min_chunk = 1;
+    size_t n_chunks = std::min(get_num_threads(),
+                               (size + min_chunk - 1) / min_chunk);
+    if (n_chunks <= 1) {
+        fn(begin, end);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(n_chunks);
+    size_t chunk = size / n_chunks, extra = size % n_chunks, first = begin;
+    for (size_t i = 0; i < n_chunks; i++) {
+        size_t last = first + chunk + (i < extra ? 1 : 0);
+        auto job = [&fn, &errors, i, first, last]() {
+            try {
+                fn(first, last);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        };
+        if (i + 1 < n_chunks)
+            threads.push_back(std::thread(job));
+        else
+            job();
+        first = last;
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (const auto& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
+/*
+ * flag raised by a writer, lowered by the first of parallel readers
+ *
+ * refresh(fn) calls fn under a lock if the flag is raised, the readers
+ * arriving meanwhile wait for it; once lowered, it costs one load.
+ */
+class stale_flag {
+    std::atomic<bool> stale;
+    std::mutex mutex;
+
+public:
+    stale_flag() : stale(false) {}
+    stale_flag(const stale_flag& other) : stale(other.stale.load()) {}
+    stale_flag& operator=(const stale_flag& other) {
+        stale = other.stale.load();
+        return *this;
+    }
+
+    void raise() {
+        stale = true;
+    }
+    template <class F>
+    void refresh(F fn) {
+        if (not stale.load(std::memory_order_acquire))
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stale.load(std::memory_order_relaxed)) {
+            fn();
+            stale.store(false, std::memory_order_release);
+        }
+    }
+};
+
+} // namespace gladys
+
+#endif // PARALLEL_HPP
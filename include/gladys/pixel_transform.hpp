@@ -0,0 +1,96 @@
+/*
+ * pixel_transform.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef PIXEL_TRANSFORM_HPP
+#define PIXEL_TRANSFORM_HPP
+
+#include <array>
+#include <cmath>
+
+#include "gdalwrap/gdal.hpp"
+#include "gladys/point.hpp"
+
+namespace gladys {
+
+typedef std::array<long, 2> pixel_t; // column, row
+
+/*
+ * affine transform between custom, utm and pixel coordinates
+ *
+ * the transform of a gdal read once: converting a point costs a couple of
+ * flops, with the same rounding as gdal::index_custom and index_utm.
+ * Loops convert their end points once and step by +-1 and +-width.
+ */
+class pixel_transform {
+    double custom_x, custom_y; // custom origin (utm)
+    double origin_x, origin_y; // utm pose of pixel (0, 0)
+    double scale_x, scale_y;
+    size_t width, height;
+
+public:
+    pixel_transform() : custom_x(0), custom_y(0), origin_x(0), origin_y(0),
+        scale_x(1), scale_y(1), width(0), height(0) {}
+    pixel_transform(const gdalwrap::gdal& map) :
+        custom_x(map.get_custom_x_origin()), custom_y(map.get_custom_y_origin()),
+        origin_x(map.get_utm_pose_x()), origin_y(map.get_utm_pose_y()),
+        scale_x(map.get_scale_x()), scale_y(map.get_scale_y()),
+        width(map.get_width()), height(map.get_height()) {}
+
+    /** pixel coordinates, not rounded */
+    point_xy_t utm2pix(const point_xy_t& p) const {
+        return point_xy_t{{(p[0] - origin_x) / scale_x,
+                           (p[1] - origin_y) / scale_y}};
+    }
+    point_xy_t custom2pix(const point_xy_t& p) const {
+        return utm2pix(point_xy_t{{p[0] + custom_x, p[1] + custom_y}});
+    }
+    point_xy_t pix2utm(double x, double y) const {
+        return point_xy_t{{x * scale_x + origin_x, y * scale_y + origin_y}};
+    }
+    point_xy_t pix2custom(double x, double y) const {
+        point_xy_t p = pix2utm(x, y);
+        return point_xy_t{{p[0] - custom_x, p[1] - custom_y}};
+    }
+
+    /** pixel of a point, rounded as gdal::index_utm */
+    pixel_t pixel_utm(const point_xy_t& p) const {
+        point_xy_t px = utm2pix(p);
+        return pixel_t{{std::lround(px[0]), std::lround(px[1])}};
+    }
+    pixel_t pixel_custom(const point_xy_t& p) const {
+        point_xy_t px = custom2pix(p);
+        return pixel_t{{std::lround(px[0]), std::lround(px[1])}};
+    }
+
+    /** index (x + y * width) of an in-map pixel */
+    size_t index(const pixel_t& px) const {
+        return px[0] + px[1] * width;
+    }
+    bool contains(const pixel_t& px) const {
+        return px[0] >= 0 and px[1] >= 0 and
+               size_t(px[0]) < width and size_t(px[1]) < height;
+    }
+
+    double get_scale_x() const {
+        return scale_x;
+    }
+    double get_scale_y() const {
+        return scale_y;
+    }
+    size_t get_width() const {
+        return width;
+    }
+    size_t get_height() const {
+        return height;
+    }
+};
+
+} // namespace gladys
+
+#endif // PIXEL_TRANSFORM_HPP
@@ -0,0 +1,244 @@
+/*
+ * pyramid.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef PYRAMID_HPP
+#define PYRAMID_HPP
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "gdalwrap/gdal.hpp"
+#include "gladys/parallel.hpp"
+
+namespace gladys {
+
+/** one overview level: cell (x, y) reduces the full resolution pixels
+ * [x * 2^level, (x + 1) * 2^level) x [y * 2^level, (y + 1) * 2^level)
+ */
+struct pyramid_level {
+    size_t width, height;
+    gdalwrap::raster min, max, mean;
+
+    const gdalwrap::raster& get(const std::string& reduction) const {
+        if (reduction == "min")
+            return min;
+        if (reduction == "max")
+            return max;
+        if (reduction == "mean")
+            return mean;
+        throw std::invalid_argument("[pyramid] unknown reduction " + reduction);
+    }
+};
+
+/*
+ * overview pyramid of a band, with min, max and mean reductions
+ *
+ * level 0 is the band itself (not stored), level k halves level k - 1
+ * (rounding up) down to a single cell. Means are over the full resolution
+ * pixels, so partial cells at the borders are weighted accordingly.
+ * Band is any type with a float operator[](x + y * width).
+ */
+class raster_pyramid {
+    size_t width, height; // full resolution
+    bool max_only; // min and mean left empty (see build)
+    std::vector<pyramid_level> levels; // levels[k - 1] is level k
+
+    /** number of full resolution pixels under a cell, along one axis */
+    static size_t span(size_t size, size_t level, size_t x) {
+        size_t first = x << level;
+        return std::min(first + (size_t(1) << level), size) - first;
+    }
+
+    template <class Band>
+    void reduce_level1(const Band& band, size_t x0, size_t y0,
+                       size_t x1, size_t y1) {
+        pyramid_level& dst = levels[0];
+        parallel_for(y0, y1, [&](size_t row_begin, size_t row_end) {
+            for (size_t y = row_begin; y < row_end; y++)
+            for (size_t x = x0; x < x1; x++) {
+                float vmin = std::numeric_limits<float>::infinity();
+                float vmax = -vmin;
+                double sum = 0;
+                size_t count = 0;
+                for (size_t py = 2 * y; py < std::min(2 * y + 2, height); py++)
+                for (size_t px = 2 * x; px < std::min(2 * x + 2, width); px++) {
+                    float value = band[px + py * width];
+                    vmin = std::min(vmin, value);
+                    vmax = std::max(vmax, value);
+                    sum += value;
+                    count++;
+                }
+                size_t idx = x + y * dst.width;
+                dst.max[idx] = vmax;
+                if (max_only)
+                    continue;
+                dst.min[idx] = vmin;
+                dst.mean[idx] = sum / count;
+            }
+        }, 16);
+    }
+
+    void reduce(size_t level, size_t x0, size_t y0, size_t x1, size_t y1) {
+        const pyramid_level& src = levels[level - 2];
+        pyramid_level& dst = levels[level - 1];
+        parallel_for(y0, y1, [&](size_t row_begin, size_t row_end) {
+            for (size_t y = row_begin; y < row_end; y++)
+            for (size_t x = x0; x < x1; x++) {
+                float vmin = std::numeric_limits<float>::infinity();
+                float vmax = -vmin;
+                double sum = 0;
+                for (size_t sy = 2 * y; sy < std::min(2 * y + 2, src.height); sy++)
+                for (size_t sx = 2 * x; sx < std::min(2 * x + 2, src.width); sx++) {
+                    size_t idx = sx + sy * src.width;
+                    vmax = std::max(vmax, src.max[idx]);
+                    if (max_only)
+                        continue;
+                    vmin = std::min(vmin, src.min[idx]);
+                    sum += double(src.mean[idx]) * span(width, level - 1, sx)
+                                                 * span(height, level - 1, sy);
+                }
+                size_t idx = x + y * dst.width;
+                dst.max[idx] = vmax;
+                if (max_only)
+                    continue;
+                dst.min[idx] = vmin;
+                dst.mean[idx] = sum / (span(width, level, x) * span(height, level, y));
+            }
+        }, 16);
+    }
+
+public:
+    raster_pyramid() : width(0), height(0), max_only(false) {}
+
+    /** build all the levels of a band
+     *
+     * @param max_only if true, only the max reduction is kept (min and
+     * mean stay empty), for a third of the memory and of the work.
+     */
+    template <class Band>
+    void build(const Band& band, size_t _width, size_t _height,
+               bool _max_only = false) {
+        width = _width;
+        height = _height;
+        max_only = _max_only;
+        levels.clear();
+        size_t w = width, h = height;
+        while (w > 1 or h > 1) {
+            pyramid_level level;
+            level.width  = w = (w + 1) / 2;
+            level.height = h = (h + 1) / 2;
+            level.max.resize(w * h);
+            if (not max_only) {
+                level.min.resize(w * h);
+                level.mean.resize(w * h);
+            }
+            levels.push_back(level);
+        }
+        update(band, 0, 0, width, height);
+    }
+
+    /** update the levels after the band changed in [x0, x1) x [y0, y1)
+     *
+     * only the cells covering the area are recomputed
+     */
+    template <class Band>
+    void update(const Band& band, size_t x0, size_t y0, size_t x1, size_t y1) {
+        x1 = std::min(x1, width);
+        y1 = std::min(y1, height);
+        if (x0 >= x1 or y0 >= y1 or levels.empty())
+            return;
+        for (size_t level = 1; level <= levels.size(); level++) {
+            x0 /= 2; y0 /= 2;
+            x1 = (x1 + 1) / 2; y1 = (y1 + 1) / 2;
+            if (level == 1)
+                reduce_level1(band, x0, y0, x1, y1);
+            else
+                reduce(level, x0, y0, x1, y1);
+        }
+    }
+
+    /** true until built */
+    bool empty() const {
+        return width == 0 and height == 0;
+    }
+    void clear() {
+        width = height = 0;
+        levels.clear();
+    }
+
+    /** number of levels, the full resolution excluded */
+    size_t size() const {
+        return levels.size();
+    }
+    /** level in [1, size()] */
+    const pyramid_level& get_level(size_t level) const {
+        if (level < 1 or level > levels.size())
+            throw std::out_of_range("[pyramid] no such level");
+        return levels[level - 1];
+    }
+    size_t get_width() const {
+        return width;
+    }
+    size_t get_height() const {
+        return height;
+    }
+};
+
+/*
+ * raster_pyramid built on first use, for const methods that may run in
+ * parallel: the first get builds it under a lock, the others wait for
+ * it. A copy starts empty, built again by its own first get.
+ */
+class lazy_pyramid {
+    raster_pyramid pyramid;
+    std::atomic<bool> built;
+    std::mutex mutex;
+
+public:
+    lazy_pyramid() : built(false) {}
+    lazy_pyramid(const lazy_pyramid&) : built(false) {}
+    lazy_pyramid& operator=(const lazy_pyramid&) {
+        clear();
+        return *this;
+    }
+
+    /** the pyramid, build(pyramid) being called if not built yet */
+    template <class Build>
+    const raster_pyramid& get(Build build) {
+        if (not built.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (not built.load(std::memory_order_relaxed)) {
+                build(pyramid);
+                built.store(true, std::memory_order_release);
+            }
+        }
+        return pyramid;
+    }
+
+    /** NOTE: not to be called while other threads get it */
+    template <class Band>
+    void update(const Band& band, size_t x0, size_t y0, size_t x1, size_t y1) {
+        if (built)
+            pyramid.update(band, x0, y0, x1, y1);
+    }
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        pyramid.clear();
+        built = false;
+    }
+};
+
+} // namespace gladys
+
+#endif // PYRAMID_HPP
@@ -0,0 +1,68 @@
+/*
+ * quantized_raster.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef QUANTIZED_RASTER_HPP
+#define QUANTIZED_RASTER_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "gdalwrap/gdal.hpp"
+
+namespace gladys {
+
+/*
+ * compact float band: 8 or 16 bits codes and a decode table
+ *
+ * Lossless when the band holds at most 2^bits distinct values (the usual
+ * case: a few hundred cost levels, unknown and +inf). Otherwise the
+ * non-positive and infinite values are kept exact and the positive ones
+ * are binned geometrically between their min and max, decoded to the
+ * geometric center of their bin (relative error < half a bin ratio).
+ *
+ * A storage format: reads decode through the table, the searches do not
+ * run on the codes (graph edges hold float weights).
+ */
+class quantized_raster {
+    size_t bits;
+    std::vector<uint8_t>  codes8;
+    std::vector<uint16_t> codes16;
+    std::vector<float> table; // decode look-up table
+    bool lossless;
+
+public:
+    /** encode a band
+     *
+     * @param band the float band
+     * @param bits 8 or 16
+     */
+    quantized_raster(const gdalwrap::raster& band, size_t bits = 8);
+
+    float operator[](size_t idx) const {
+        return bits == 8 ? table[codes8[idx]] : table[codes16[idx]];
+    }
+    size_t size() const {
+        return bits == 8 ? codes8.size() : codes16.size();
+    }
+    size_t get_bits() const {
+        return bits;
+    }
+    bool is_lossless() const {
+        return lossless;
+    }
+    const std::vector<float>& get_table() const {
+        return table;
+    }
+    /** decode the whole band */
+    gdalwrap::raster decode() const;
+};
+
+} // namespace gladys
+
+#endif // QUANTIZED_RASTER_HPP
@@ -12,7 +12,12 @@
 #define ROBOT_MODEL_HPP
 
 #include <string>
+#include <cmath> // for isnan
+#include <limits> // for numeric_limits::quiet_NaN
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 
 #include <boost/version.hpp>
 // json_parser bug #6785 in boost 1.49
@@ -29,69 +34,253 @@
 
 namespace gladys {
 
+/** cost model compiled against a region band layout
+ *
+ * coefs[i] is the ponderation of the region band i (0 if not a cost class),
+ * cost_bands the bands of the cost classes in the order of their names
+ * (std::map), which is the order of the weighted sum.
+ */
+struct cost_model {
+    std::vector<float> coefs;
+    std::vector<size_t> cost_bands;
+    size_t obstacle_band, unknown_band;
+    double obstacle_threshold, unknown_threshold;
+};
+
+/** robot model parameters, parsed once from the json tree
+ *
+ * NaN stands for a missing value. The antenna values are the sensor ones
+ * when the model has no "antenna" object.
+ */
+struct robot_params {
+    double mass, radius, velocity;
+    bool inflate;
+    double inflation_falloff;
+    point_xyzt_t sensor_pose;
+    double sensor_fov, sensor_range;
+    point_xyzt_t antenna_pose;
+    double antenna_fov, antenna_range;
+};
+
 /*
  * from robot model (in json)
  */
 class robot_model {
     boost::property_tree::ptree pt;
+    robot_params params;
+    std::map<std::string, float> costs;
+    std::string obstacle_class, unknown_class;
+    double obstacle_threshold, unknown_threshold;
+
+    static size_t band_index(const std::vector<std::string>& names,
+                             const std::string& name) {
+        auto it = std::find(names.begin(), names.end(), name);
+        if (it == names.end())
+            throw std::runtime_error("[robot_model] no band for class " + name);
+        return it - names.begin();
+    }
+
+    double _get(const std::string& path) const {
+        return pt.get<double>(path, std::numeric_limits<double>::quiet_NaN());
+    }
+    point_xyzt_t _get_pose(const std::string& path) const {
+        point_xyzt_t p ;
+        p[0] = _get(path + ".pose.x");
+        p[1] = _get(path + ".pose.y");
+        p[2] = _get(path + ".pose.z");
+        p[3] = _get(path + ".pose.t");
+        return p ;
+    }
+    /** throw if the value is missing from the model */
+    static double _required(double value, const char* path) {
+        if (std::isnan(value))
+            throw std::runtime_error(std::string("[robot_model] no ") + path);
+        return value;
+    }
+    static const point_xyzt_t& _required(const point_xyzt_t& p, const char* path) {
+        for (double value : p)
+            _required(value, path);
+        return p;
+    }
+
+    /** parse the parameters, called after every change of the tree */
+    void _load_params() {
+        params.mass              = _get("robot.mass");
+        params.radius            = _get("robot.radius");
+        params.velocity          = _get("robot.velocity");
+        params.inflate           = pt.get<bool>("robot.inflate", false);
+        params.inflation_falloff = pt.get<double>("robot.inflation_falloff", 0.0);
+        params.sensor_pose       = _get_pose("sensor");
+        params.sensor_fov        = _get("sensor.fov");
+        params.sensor_range      = _get("sensor.range");
+        if (pt.count("antenna") == 0) {
+            params.antenna_pose  = params.sensor_pose;
+            params.antenna_fov   = params.sensor_fov;
+            params.antenna_range = params.sensor_range;
+        } else {
+            params.antenna_pose  = _get_pose("antenna");
+            params.antenna_fov   = _get("antenna.fov");
+            params.antenna_range = _get("antenna.range");
+        }
+    }
+
+    void _load_costs() {
+        costs.clear();
+        auto pt_costs = pt.get_child_optional("costs");
+        if (pt_costs) {
+            for (const auto& kv : *pt_costs)
+                costs[kv.first] = kv.second.get_value<float>();
+        } else {
+            costs["FLAT"]  = 0.0; // v-max     on flat   ground
+            costs["ROUGH"] = 5.0; // v-max / 5 on rought ground
+        }
+        obstacle_class     = pt.get<std::string>("obstacle.class", "OBSTACLE");
+        obstacle_threshold = pt.get<double>("obstacle.threshold", 0.4);
+        unknown_class      = pt.get<std::string>("unknown.class", "NO_3D_CLASS");
+        unknown_threshold  = pt.get<double>("unknown.threshold", 0.9);
+    }
 
 public:
+    robot_model() {
+        _load_params();
+        _load_costs();
+    }
+
     /** load robot model
      *
      * @param filepath path to a robot model
      *
      */
     void load(const std::string& filepath) {
+        pt.clear();
         read_json(filepath, pt);
         // throw an exception if a key is not found
         if (pt.get<double>("robot.mass")     <= 0 or
             pt.get<double>("robot.radius")   <= 0 or
             pt.get<double>("robot.velocity") <= 0 )
             throw std::runtime_error("[robot_model] mass, radius and velocity must be positive");
+        _load_params();
+        _load_costs();
     }
 
-    /* TODO get a **dymanic** map for weight function
+    /** parameters parsed at load time, kept up to date by the setters
+     *
+     * the getters below read them, the json tree is not searched per call.
+     */
+    const robot_params& get_params() const {
+        return params;
+    }
 
-       string("REGION_MAP_BAND_OR_CLASS_NAME") -> float(ponderation)
+    /** cost model: ponderation of the terrain classes
+     *
+     * read from the optional "costs" object of the robot model
+     * (band name -> ponderation), defaults to:
+
+       string("FLAT")       -> float(0.0) v-max     on flat   ground
+       string("ROUGH")      -> float(5.0) v-max / 5 on rought ground
 
-       string("OBSTACLE")   -> float(+infinite)
-       string("FLAT")       -> float(0.0)
-       string("ROUGH")      -> float(0.5)
-       string("SLOPE")      -> float(0.6)
-       ...
+     * parsed once at load time.
      */
-    std::map<std::string, float> get_costs() const {
-        std::map<std::string, float> costs;
-        costs["FLAT"]  = 0.0; // v-max     on flat   ground
-        costs["ROUGH"] = 5.0; // v-max / 5 on rought ground
-        // costs["SLOPE"] = 3.0; // v-max / 3 on slope  ground
-        // threshold not cost ["OBSTACLE"] = 1E+6;
-        // threshold not cost ["NO_3D_CLASS"] = -1;
+    const std::map<std::string, float>& get_costs() const {
         return costs;
     }
 
+    void set_cost(const std::string& name, float cost) {
+        costs[name] = cost;
+        // keep the whole model in the tree, for save()
+        for (const auto& kv : costs)
+            pt.put(boost::property_tree::ptree::path_type(
+                "costs/" + kv.first, '/'), kv.second);
+    }
+
+    /** thresholds on the probability of the obstacle and unknown classes
+     *
+     * optional "obstacle" and "unknown" objects: {"class": "OBSTACLE",
+     * "threshold": 0.4} and {"class": "NO_3D_CLASS", "threshold": 0.9}
+     */
+    const std::string& get_obstacle_class() const {
+        return obstacle_class;
+    }
+    double get_obstacle_threshold() const {
+        return obstacle_threshold;
+    }
+    const std::string& get_unknown_class() const {
+        return unknown_class;
+    }
+    double get_unknown_threshold() const {
+        return unknown_threshold;
+    }
+
+    /** compile the cost model for a region band layout
+     *
+     * @param names region band names
+     * @returns coefficients aligned with the region band indices
+     * @throws std::runtime_error if a class is not in the region
+     */
+    cost_model compile_costs(const std::vector<std::string>& names) const {
+        cost_model model;
+        model.coefs.assign(names.size(), 0);
+        for (const auto& kv : costs) {
+            size_t band = band_index(names, kv.first);
+            model.coefs[band] = kv.second;
+            model.cost_bands.push_back(band);
+        }
+        model.obstacle_band = band_index(names, obstacle_class);
+        model.obstacle_threshold = obstacle_threshold;
+        model.unknown_band = band_index(names, unknown_class);
+        model.unknown_threshold = unknown_threshold;
+        return model;
+    }
+
     double get_mass() const {
-        return pt.get<double>("robot.mass");
+        return _required(params.mass, "robot.mass");
     }
 
     void set_mass(double mass) {
         pt.put("robot.mass", mass);
+        _load_params();
     }
 
     double get_radius() const {
-        return pt.get<double>("robot.radius");
+        return _required(params.radius, "robot.radius");
     }
 
     void set_radius(double radius) {
         pt.put("robot.radius", radius);
+        _load_params();
+    }
+
+    /** inflate obstacles by the robot radius when building weight maps
+     * (optional "robot.inflate", default false)
+     */
+    bool get_inflate() const {
+        return params.inflate;
+    }
+
+    void set_inflate(bool inflate) {
+        pt.put("robot.inflate", inflate);
+        _load_params();
+    }
+
+    /** distance beyond the radius over which the weight decreases
+     * (optional "robot.inflation_falloff" in meters, default 0: hard flag)
+     */
+    double get_inflation_falloff() const {
+        return params.inflation_falloff;
+    }
+
+    void set_inflation_falloff(double falloff) {
+        pt.put("robot.inflation_falloff", falloff);
+        _load_params();
     }
 
     double get_velocity() const {
-        return pt.get<double>("robot.velocity");
+        return _required(params.velocity, "robot.velocity");
     }
 
     void set_velocity(double velocity) {
         pt.put("robot.velocity", velocity);
+        _load_params();
     }
 
     /** get the position of the eye sensor
@@ -100,21 +289,16 @@ public:
      * used to build the visibility map
      * we need to consider a better orientation for flying observers
      */
-    point_xyzt_t get_sensor_pose() const {
-        point_xyzt_t p ;
-        p[0] = pt.get<double>("sensor.pose.x");
-        p[1] = pt.get<double>("sensor.pose.y");
-        p[2] = pt.get<double>("sensor.pose.z");
-        p[3] = pt.get<double>("sensor.pose.t");
-        return p ;
+    const point_xyzt_t& get_sensor_pose() const {
+        return _required(params.sensor_pose, "sensor.pose");
     }
 
     double get_sensor_fov() const {
-        return pt.get<double>("sensor.fov");
+        return _required(params.sensor_fov, "sensor.fov");
     }
 
     double get_sensor_range() const {
-        return pt.get<double>("sensor.range");
+        return _required(params.sensor_range, "sensor.range");
     }
 
     void set_sensor_pose( point_xyzt_t p ) {
@@ -122,14 +306,17 @@ public:
         pt.put("sensor.pose.y", p[1] );
         pt.put("sensor.pose.z", p[2] );
         pt.put("sensor.pose.t", p[3] );
+        _load_params();
     }
 
     void set_sensor_fov(double fov) {
         pt.put("sensor.fov", fov );
+        _load_params();
     }
 
     void set_sensor_range(double range) {
         pt.put("sensor.range", range );
+        _load_params();
     }
 
     /** get the position of the antenna
@@ -139,30 +326,16 @@ public:
      * used to computue the visibility for communication
      * we need to consider a better orientation for flying observers
      */
-    point_xyzt_t get_antenna_pose() const {
-        if(pt.count("antenna") == 0){
-            return get_sensor_pose();
-        }
-        point_xyzt_t p ;
-        p[0] = pt.get<double>("antenna.pose.x");
-        p[1] = pt.get<double>("antenna.pose.y");
-        p[2] = pt.get<double>("antenna.pose.z");
-        p[3] = pt.get<double>("antenna.pose.t");
-        return p ;
+    const point_xyzt_t& get_antenna_pose() const {
+        return _required(params.antenna_pose, "antenna.pose");
     }
 
     double get_antenna_fov() const {
-        if(pt.count("antenna") == 0){
-            return get_sensor_fov();
-        }
-        return pt.get<double>("antenna.fov");
+        return _required(params.antenna_fov, "antenna.fov");
     }
 
     double get_antenna_range() const {
-        if(pt.count("antenna") == 0){
-            return get_sensor_range();
-        }
-        return pt.get<double>("antenna.range");
+        return _required(params.antenna_range, "antenna.range");
     }
 
     void set_antenna_pose( point_xyzt_t p ) {
@@ -170,14 +343,17 @@ public:
         pt.put("antenna.pose.y", p[1] );
         pt.put("antenna.pose.z", p[2] );
         pt.put("antenna.pose.t", p[3] );
+        _load_params();
     }
 
     void set_antenna_fov(double fov) {
         pt.put("antenna.fov", fov );
+        _load_params();
     }
 
     void set_antenna_range(double range) {
         pt.put("antenna.range", range );
+        _load_params();
     }
 
     void save(const std::string& filepath) const {
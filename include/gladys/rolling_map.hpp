@@ -0,0 +1,106 @@
+/*
+ * rolling_map.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef ROLLING_MAP_HPP
+#define ROLLING_MAP_HPP
+
+#include <vector>
+
+#include "gladys/point.hpp"
+#include "gladys/graph_astar.hpp"
+#include "gladys/weight_map.hpp"
+
+namespace gladys {
+
+/*
+ * robot-centred local window of a weight map, with its navigation graph
+ *
+ * Cells are stored in a ring buffer (toroidal addressing): the global pixel
+ * (x, y) lives in slot (x mod (width + 1), y mod (height + 1)). The extra
+ * column and row are a guard band, whose edges are blocked, and whose
+ * vertices are the east/south sides of the window border cells.
+ *
+ * Each slot owns two vertices (its west and north sides) and the six edges
+ * of its cell; the graph topology is built once. When the window scrolls,
+ * only the newly exposed strips are refreshed: vertex positions and edge
+ * weights are rewritten in place (edge::t set), nothing is reallocated.
+ */
+class rolling_map {
+    const weight_map& map; // global weight map
+    size_t width, height;   // window size (in cells)
+    size_t ring_w, ring_h;  // ring size (window + guard band)
+    long origin_x, origin_y; // global pixel of the window upper-left cell
+    graph_t g;
+    std::vector<edge_t> edges; // 6 per slot
+    double scale_x, scale_y;
+    float hypotenuse;
+
+    size_t slot(long x, long y) const {
+        long sx = x % long(ring_w), sy = y % long(ring_h);
+        if (sx < 0) sx += ring_w;
+        if (sy < 0) sy += ring_h;
+        return sx + sy * ring_w;
+    }
+    bool in_window(long x, long y) const {
+        return x >= origin_x and x < origin_x + long(width)
+           and y >= origin_y and y < origin_y + long(height);
+    }
+    /** (re)assign the slot of global pixel (x, y) to it */
+    void update_cell(long x, long y, time_t t);
+    void update_column(long x, time_t t);
+    void update_row(long y, time_t t);
+
+public:
+    /** rolling_map constructor
+     *
+     * @param w_map global weight map, must outlive the rolling map
+     * @param width window width (in cells)
+     * @param height window height (in cells)
+     * @param center initial center of the window (UTM)
+     */
+    rolling_map(const weight_map& w_map, size_t width, size_t height,
+                const point_xy_t& center);
+
+    /** move the window center (UTM)
+     *
+     * refreshes the cells exposed since the last position
+     * (the whole window if it moved by more than its size).
+     * Cells out of the global map are obstacles.
+     */
+    void recenter(const point_xy_t& center);
+
+    /** closest vertex of the window to p (UTM) */
+    vertex_t get_closest_vertex(const point_xy_t& p) const;
+
+    path_cost_util_t astar_search(const point_xy_t& start,
+                                  const point_xy_t& goal) const;
+
+    /** weight of a cell of the window (global pixel), as in the graph */
+    float get_weight(long x, long y) const;
+
+    long get_origin_x() const {
+        return origin_x;
+    }
+    long get_origin_y() const {
+        return origin_y;
+    }
+    size_t get_width() const {
+        return width;
+    }
+    size_t get_height() const {
+        return height;
+    }
+    const graph_t& get_graph() const {
+        return g;
+    }
+};
+
+} // namespace gladys
+
+#endif // ROLLING_MAP_HPP
@@ -0,0 +1,114 @@
+/*
+ * visibility_cache.hpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#ifndef VISIBILITY_CACHE_HPP
+#define VISIBILITY_CACHE_HPP
+
+#include <map>
+#include <cmath>
+#include <tuple>
+#include <mutex>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "gladys/cache.hpp"
+
+namespace gladys {
+
+/*
+ * line-of-sight answers, keyed by cell pair and heights (in centimetres)
+ *
+ * a thin thread-safe layer over lru_cache: lookups and insertions are
+ * locked, the tests run outside the lock so that parallel queries do not
+ * wait on each other. A copy starts disabled, the test being bound to
+ * the map that enabled it.
+ */
+class visibility_cache {
+public:
+    // link (tested both ways, without heights), sensor cell, sensor
+    // height, target cell, target height (heights in quanta)
+    typedef std::tuple<bool, size_t, long, size_t, long> key_type;
+    typedef lru_cache<key_type, bool, std::map> cache_type;
+
+    static constexpr double quantum = 0.01; // m
+
+private:
+    std::unique_ptr<cache_type> cache;
+    cache_type::fun_type fn;
+    std::mutex mutex;
+
+public:
+    visibility_cache() {}
+    visibility_cache(const visibility_cache&) {}
+    visibility_cache& operator=(const visibility_cache&) {
+        disable();
+        return *this;
+    }
+
+    /** keep up to 'capacity' answers of fn */
+    void enable(cache_type::fun_type fun, size_t capacity) {
+        if (capacity == 0)
+            throw std::invalid_argument("[visibility_cache] empty cache");
+        std::lock_guard<std::mutex> lock(mutex);
+        cache.reset(new cache_type(fun, capacity));
+        fn = fun;
+    }
+    void disable() {
+        std::lock_guard<std::mutex> lock(mutex);
+        cache.reset();
+    }
+    /** NOTE: not to be called while enabling or disabling */
+    bool enabled() const {
+        return bool(cache);
+    }
+    void invalidate() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache)
+            cache->invalidate();
+    }
+
+    /** key of a test from cell s to cell t (indices), in this order: the
+     * test is not symmetric (the Bresenham line and the distances are
+     * from s). The heights are rounded to the quantum.
+     */
+    key_type key(size_t s, double zs, size_t t, double zt) const {
+        return key_type(false, s, std::lround(zs / quantum),
+                               t, std::lround(zt / quantum));
+    }
+    /** key of a link between cells a and b, tested both ways: the same
+     * for (a, b) and (b, a)
+     */
+    key_type link_key(size_t a, size_t b) const {
+        return key_type(true, std::min(a, b), 0, std::max(a, b), 0);
+    }
+    static double height(long quanta) {
+        return quanta * quantum;
+    }
+
+    /** the cached answer, or fn(k) computed and recorded */
+    bool operator()(const key_type& k) {
+        bool v;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (cache and cache->find(k, v))
+                return v;
+        }
+        v = fn(k);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache) // not disabled meanwhile
+            cache->store(k, v);
+        return v;
+    }
+};
+
+} // namespace gladys
+
+#endif // VISIBILITY_CACHE_HPP
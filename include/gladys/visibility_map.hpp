@@ -12,10 +12,20 @@
 #define VISIBILITY_MAP_HPP
 
 #include <string>
+#include <vector>
+#include <memory> // for shared_ptr
+#include <algorithm>
+#include <stdexcept>
 
 #include "gdalwrap/gdal.hpp"
 #include "gladys/robot_model.hpp"
 #include "gladys/point.hpp"
+#include "gladys/mapped_raster.hpp"
+#include "gladys/pyramid.hpp"
+#include "gladys/packed_dtm.hpp"
+#include "gladys/pixel_transform.hpp"
+#include "gladys/horizon_map.hpp"
+#include "gladys/visibility_cache.hpp"
 
 namespace gladys {
 
@@ -24,11 +34,72 @@ namespace gladys {
  */
 class visibility_map {
     gdalwrap::gdal dtm; // digital terrain map (multi-layers GeoTiff)
+    // Z_MAX and N_POINTS memory-mapped instead of dtm bands (see load_mapped)
+    std::shared_ptr<const mapped_raster> mapped;
+    const tiled_raster* z_max_tiles = nullptr;
+    const tiled_raster* n_points_tiles = nullptr;
+    // Z_MAX and N_POINTS interleaved, built at load time (see pack)
+    mutable packed_dtm cells;
+    // raised by the mutable get_dtm, the cells are packed again on use
+    mutable stale_flag dtm_stale;
+    // overviews of Z_MAX, built on demand (see get_pyramid)
+    mutable raster_pyramid pyramid;
+    // max of Z_MAX, built by the first line-of-sight test (see get_occluders)
+    mutable lazy_pyramid occluders;
+    // antenna horizons, optional (see build_horizons)
+    horizon_map horizons;
+    // line-of-sight answers, optional (see enable_cache)
+    mutable visibility_cache cache;
     robot_model rmdl;
     size_t width;  // dtm width
     size_t height; // dtm height
 
     void _load();
+    void _pack_cells() const;
+
+    /** the packed cells, throw if the dtm misses Z_MAX or N_POINTS */
+    const packed_dtm& get_cells() const {
+        dtm_stale.refresh([this] {
+            _pack_cells();
+            occluders.clear();
+            pyramid.clear();
+            cache.invalidate();
+        });
+        if (cells.empty()) {
+            get_heightmap();
+            get_npointsmap();
+        }
+        return cells;
+    }
+
+    /** max-only pyramid of Z_MAX, for the line-of-sight rejection */
+    const raster_pyramid& get_occluders() const {
+        return occluders.get([this](raster_pyramid& p) {
+            if (mapped)
+                p.build(*z_max_tiles, width, height, true);
+            else
+                p.build(get_heightmap(), width, height, true);
+        });
+    }
+
+    template <class Cells>
+    bool _is_visible( const Cells& cells, const point_xyz_t& s,
+                      const point_xyz_t& t) const ;
+    bool _is_visible( const point_xyz_t& s, const point_xyz_t& t) const ;
+    bool _is_visible( const visibility_cache::key_type& k) const ;
+    int _antenna_settled( const point_xy_t& a, const point_xy_t& t,
+                          bool conservative, point_xyz_t& s3D,
+                          point_xyz_t& t3D) const ;
+    template <class Cells>
+    gdalwrap::raster _viewshed( const Cells& cells, const point_xy_t& s) const ;
+    template <class Cells>
+    gdalwrap::raster _viewshed_approx( const Cells& cells,
+                                       const point_xy_t& s) const ;
+    template <class Cells>
+    void _is_sensor_visible( const Cells& cells, const point_xy_t& s,
+                             const points_t& targets,
+                             const std::vector<size_t>& order,
+                             std::vector<char>& visible) const ;
 
 public:
     visibility_map() {}
@@ -45,11 +116,40 @@ public:
      *
      */
     void load(const std::string& f_dtm, const std::string& f_robot_model) {
+        mapped.reset();
         dtm.load(f_dtm);
         rmdl.load(f_robot_model);
         _load();
     }
 
+    /** save Z_MAX and N_POINTS in the tiled layout of mapped_raster */
+    void save_mapped(const std::string& filepath) const {
+        mapped_raster::save(dtm, {"Z_MAX", "N_POINTS"}, filepath);
+    }
+
+    /** load dtm bands from a file written by save_mapped, and robot model
+     *
+     * the file is memory-mapped read-only: processes loading the same file
+     * share its pages, and only the pages read are loaded.
+     * get_heightmap and get_npointsmap throw, the bands are not resident.
+     */
+    void load_mapped(const std::string& f_dtm, const std::string& f_robot_model) {
+        mapped.reset(new mapped_raster(f_dtm));
+        z_max_tiles = &mapped->get_band("Z_MAX"); // throw if missing
+        n_points_tiles = &mapped->get_band("N_POINTS");
+        dtm = mapped->get_meta();
+        rmdl.load(f_robot_model);
+        _load();
+    }
+
+    /** load dtm and robot model, streaming the dtm
+     *
+     * the dtm is read block by block and only its Z_MAX and N_POINTS
+     * bands are kept, the others are never loaded.
+     */
+    void load_streamed(const std::string& f_dtm,
+                       const std::string& f_robot_model);
+
     /* computing function */
 
     /** test if point 't' (target) is visible from 's' (sensor)
@@ -75,6 +175,26 @@ public:
      */
     bool is_visible( const point_xyz_t& s, const point_xyz_t& t) const ;
 
+    /** test if the center of cell 't' is visible from the one of cell 's'
+     *
+     * is_visible between the cell centers, the heights being rounded to
+     * the centimetre: the same queries give the same keys, cached when
+     * enabled (see enable_cache).
+     *
+     * @param s the cell of the sensor (pixel)
+     *
+     * @param zs the height of the sensor above its cell
+     *
+     * @param t the cell of the target (pixel)
+     *
+     * @param zt the height of the target above its cell
+     *
+     * @returns true if visible.
+     *
+     */
+    bool is_visible_cell( const pixel_t& s, double zs,
+                          const pixel_t& t, double zt) const ;
+
     /** test if point 't' (target) is visible from 's' (sensor)
      * Assume an height of 0 for the target and use the sensor pose for the sensor height.
      * Also use the sensor range
@@ -101,6 +221,25 @@ public:
      */
     bool is_sensor_visible( const point_xyz_t& s, const point_xyz_t& t) const ;
 
+    /** test which targets are visible from 's' (sensor), see is_sensor_visible
+     *
+     * the targets are sorted by azimuth then distance, identical targets
+     * are tested once, and the tests are split across threads. Lines in
+     * the same direction share their first cells: the maximum slope of
+     * the cells walked is kept along the last line, and answers for the
+     * cells the next one shares with it, unless too close to the slope of
+     * the target to call (then these cells are tested again).
+     *
+     * @param s the position of the sensor
+     *
+     * @param targets the positions of the targets
+     *
+     * @returns for each target, the same as is_sensor_visible(s, target).
+     *
+     */
+    std::vector<bool> is_sensor_visible( const point_xy_t& s,
+                                         const points_t& targets) const ;
+
     /** test if point 't' (target) is visible from 'a' (antenna)
      * Assume an height of 0 for the target and use the antenna pose for the antenna height
      * Also use the antenna range
@@ -127,6 +266,113 @@ public:
      */
     bool is_antenna_visible( const point_xyz_t& a, const point_xyz_t& t) const ;
 
+    /** test if robots at the centers of cells 'a' and 'b' are linked:
+     * is_antenna_visible both ways. Symmetric, cached once for (a, b) and
+     * (b, a) when enabled (see enable_cache).
+     *
+     * @param a the cell of a robot (pixel)
+     *
+     * @param b the cell of the other robot (pixel)
+     *
+     * @returns true if each antenna sees the other robot.
+     *
+     */
+    bool is_antenna_link_cell( const pixel_t& a, const pixel_t& b) const ;
+
+    /** test if point 't' (target) is visible from 'a' (antenna), in O(1)
+     * when the horizons are built (see build_horizons)
+     *
+     * the target is visible if above the upper horizon towards it (a bound:
+     * always right). Otherwise, when conservative or without lower map,
+     * is_antenna_visible decides: the answers are exact. Else the target
+     * is deemed hidden if below the lower horizon of its sector before it
+     * (the occluder may be beside the line), visible if above it (an
+     * occluder may lie in its ring).
+     *
+     * @param a the position of the robot
+     *
+     * @param t the position of the target
+     *
+     * @param conservative fall back to is_antenna_visible unless certified
+     *
+     * @returns true if visible.
+     *
+     */
+    bool is_antenna_visible_approx( const point_xy_t& a, const point_xy_t& t,
+                                    bool conservative = true) const ;
+
+    /** test if robots at 'a' and 'b' are linked: is_antenna_visible_approx
+     * both ways, tested together. The O(1) tests of both ways (range,
+     * unknown cells, horizons) come first, and a line is only walked if
+     * neither way is settled hidden.
+     *
+     * @param a the position of a robot
+     *
+     * @param b the position of the other robot
+     *
+     * @param conservative see is_antenna_visible_approx
+     *
+     * @returns true if each antenna sees the other robot.
+     *
+     */
+    bool is_antenna_link_approx( const point_xy_t& a, const point_xy_t& b,
+                                 bool conservative = true) const ;
+
+    /** compute the antenna horizons of every cell
+     *
+     * for each of 'sectors' azimuth sectors, the steepest slope of the
+     * cells in antenna range, and in 'rings' - 1 shorter ranges (see
+     * horizon_map); built in parallel, in O(N * range^2), stored in
+     * N * sectors * rings floats, twice with the lower map (only used by
+     * the non-conservative is_antenna_visible_approx).
+     * NOTE: dropped by edit_dtm, build them again after an edit.
+     */
+    void build_horizons(size_t sectors = 32, size_t rings = 1,
+                        bool lower = false);
+
+    /** save the horizons, one band per sector on the dtm meta-data */
+    void save_horizons(const std::string& filepath) const {
+        horizons.to_gdal(dtm).save(filepath);
+    }
+
+    /** load horizons written by save_horizons for this dtm and antenna */
+    void load_horizons(const std::string& filepath);
+
+    const horizon_map& get_horizons() const {
+        return horizons;
+    }
+
+    /** cells visible by the sensor from 's' (robot position)
+     *
+     * is_sensor_visible on every cell center in range, by a radial sweep
+     * (see viewshed_approx) bounding the line of each cell by the ray
+     * crossing it: the cells the bounds do not settle, close to the
+     * horizon, are tested on their own line by the batched test.
+     *
+     * @param s the position of the robot
+     *
+     * @returns a raster of the dtm size, 1 where visible, 0 elsewhere.
+     *
+     */
+    gdalwrap::raster viewshed( const point_xy_t& s ) const ;
+
+    /** approximate viewshed from 's' (robot position), by a radial sweep
+     *
+     * same semantics as viewshed, but by Franklin and Ray's R2 sweep
+     * alone: rays are cast from the sensor cell to the border of the
+     * range, each keeping the maximum slope met so far, O(N) in the
+     * number of cells in range. A cell is tested on the rays crossing it
+     * rather than on its own line, and is visible if one of them sees
+     * it: the answers differ from viewshed close to occluder edges (a
+     * few percent of the cells in range).
+     *
+     * @param s the position of the robot
+     *
+     * @returns a raster of the dtm size, 1 where visible, 0 elsewhere.
+     *
+     */
+    gdalwrap::raster viewshed_approx( const point_xy_t& s ) const ;
+
     /** Get the index of the point in the raster
      *
      * @param p the point
@@ -138,18 +384,140 @@ public:
         return dtm.index_custom(p[0], p[1]);
     }
 
+    /** transform of the dtm, read once to work in pixels */
+    pixel_transform get_pixel_transform() const {
+        return pixel_transform(dtm);
+    }
+    pixel_t pixel( const point_xy_t& p ) const {
+        return get_pixel_transform().pixel_custom(p);
+    }
+    size_t index_pix( const pixel_t& px ) const {
+        return px[0] + px[1] * width;
+    }
+
     /* getters */
     const gdalwrap::raster& get_heightmap() const {
+        if (mapped)
+            throw std::runtime_error("[visibility_map] Z_MAX is memory-mapped");
         return dtm.get_band("Z_MAX");
     }
 
     const gdalwrap::raster& get_npointsmap() const {
+        if (mapped)
+            throw std::runtime_error("[visibility_map] N_POINTS is memory-mapped");
         return dtm.get_band("N_POINTS");
     }
 
+    /** memoise is_visible_cell and is_antenna_link_cell, by cell pair
+     *
+     * the queries snapped to cells, keyed by the sensor and target cells
+     * and their heights in centimetres (in this order, the test is not
+     * symmetric), or by the two cells of a link (in either order). The
+     * answers are the same as without cache. At most 'capacity' answers
+     * are kept, the least recently used are evicted. The cache is cleared
+     * when the dtm is loaded or edited, and is not copied with the map.
+     * The other tests (is_visible on points, viewshed) do not use it.
+     */
+    void enable_cache(size_t capacity) {
+        cache.enable([this](const visibility_cache::key_type& k) {
+            return _is_visible(k);
+        }, capacity);
+    }
+    void disable_cache() {
+        cache.disable();
+    }
+
+    /** overview pyramid of Z_MAX (min, max and mean)
+     *
+     * built in parallel on the first call, reading every tile of a
+     * memory-mapped dtm. The line-of-sight tests do not use it, but a
+     * max-only pyramid of their own built by the first of them.
+     */
+    const raster_pyramid& get_pyramid() const {
+        if (pyramid.empty()) {
+            if (mapped)
+                pyramid.build(*z_max_tiles, width, height);
+            else
+                pyramid.build(get_heightmap(), width, height);
+        }
+        return pyramid;
+    }
+
+    /** edit Z_MAX and N_POINTS in [x0, x1) x [y0, y1)
+     *
+     * calls edit(x, y, z_max, n_points) for each cell, z_max and n_points
+     * being float references to the bands. Then everything derived from
+     * them follows: the pyramid and the packed cells are refreshed over
+     * the region, the cache is cleared and the horizons are dropped
+     * (build them again). A memory-mapped dtm is read-only.
+     */
+    template <class Edit>
+    void edit_dtm(size_t x0, size_t y0, size_t x1, size_t y1, Edit edit) {
+        if (mapped)
+            throw std::runtime_error("[visibility_map] the dtm is memory-mapped");
+        x1 = std::min(x1, width);
+        y1 = std::min(y1, height);
+        gdalwrap::raster& z_max = dtm.get_band("Z_MAX");
+        gdalwrap::raster& n_points = dtm.get_band("N_POINTS");
+        for (size_t y = y0; y < y1; y++)
+            for (size_t x = x0; x < x1; x++)
+                edit(x, y, z_max[x + y * width], n_points[x + y * width]);
+        horizons.clear();
+        cache.invalidate();
+        if (not cells.empty())
+            cells.update(z_max, n_points, x0, y0, x1, y1);
+        if (not pyramid.empty()) // else built on the next get_pyramid
+            pyramid.update(z_max, x0, y0, x1, y1);
+        occluders.update(z_max, x0, y0, x1, y1);
+    }
+
+    /** set one cell, see edit_dtm */
+    void set_cell(size_t x, size_t y, float z_max, float n_points) {
+        edit_dtm(x, y, x + 1, y + 1, [&](size_t, size_t, float& z, float& n) {
+            z = z_max;
+            n = n_points;
+        });
+    }
+
+    /** interleave Z_MAX and N_POINTS again, in Morton order if morton is set
+     *
+     * the line-of-sight tests read the interleaved cells, built in
+     * row-major order at load time; the layout is kept across loads.
+     * Z_MAX and N_POINTS are kept as is, for get_dtm and save.
+     * Does nothing on a memory-mapped dtm, already tiled.
+     */
+    void pack(bool morton) {
+        if (mapped)
+            return;
+        cells.pack(get_heightmap(), get_npointsmap(), width, height, morton);
+    }
+    bool is_morton() const {
+        return cells.is_morton();
+    }
+
+    /** NOTE: edit the dtm through edit_dtm */
     const gdalwrap::gdal& get_dtm() const {
         return dtm;
     }
+    /** DEPRECATED: use edit_dtm or set_cell
+     *
+     * the packed cells, the pyramids and the cache are marked stale and
+     * refreshed by the next line-of-sight test, the horizons are dropped.
+     * Keep the reference only while editing: tests run in between would
+     * fill the cache with the old answers.
+     */
+    gdalwrap::gdal& get_dtm() {
+        horizons.clear();
+        cache.invalidate();
+        pyramid.clear();
+        occluders.clear();
+        dtm_stale.raise();
+        return dtm;
+    }
+
+    const robot_model& get_robot() const {
+        return rmdl;
+    }
 
     size_t get_width() const {
         return width;
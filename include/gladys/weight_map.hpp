@@ -13,26 +13,68 @@
 #include <string>
 #include <limits> // for numeric_limits::infinity
 #include <map>
+#include <vector>
+#include <memory> // for shared_ptr
 
 #include "gdalwrap/gdal.hpp"
 #include "gladys/robot_model.hpp"
+#include "gladys/mapped_raster.hpp"
+#include "gladys/quantized_raster.hpp"
+#include "gladys/pyramid.hpp"
+#include "gladys/pixel_transform.hpp"
 
 namespace gladys {
 
+class weight_map;
+
+/** weight maps of several robot models sharing the same terrains
+ *
+ * the N weight bands are blended in a single pass over the terrain bands,
+ * which are loaded once and shared by the returned weight maps.
+ */
+std::vector<weight_map> make_weight_maps(
+        std::shared_ptr<const gdalwrap::gdal> terrains,
+        const std::vector<robot_model>& robots);
+std::vector<weight_map> make_weight_maps(const std::string& f_region,
+        const std::vector<robot_model>& robots);
+
 /*
  * from terrains model (in multi-layers GeoTiff)
  * to single layers weight map (after inflating obstacles by robot size)
  */
 class weight_map {
 protected:
-    gdalwrap::gdal terrains; // probalistic models (multi-layers GeoTiff)
+    // probalistic models (multi-layers GeoTiff), may be shared between maps
+    std::shared_ptr<const gdalwrap::gdal> terrains;
     gdalwrap::gdal map; // weight map (after inflating robot size)
+    // weight band memory-mapped instead of map.bands[0] (see load_mapped)
+    std::shared_ptr<const mapped_raster> mapped;
+    const tiled_raster* weight_tiles = nullptr;
+    // weight band quantized instead of map.bands[0] (see quantize)
+    std::shared_ptr<const quantized_raster> quantized;
+    // overviews of the weight band, built on demand (see get_pyramid)
+    mutable raster_pyramid pyramid;
     robot_model rmdl;
     size_t width ;
     enum {W_FLAG_OBSTACLE=-2, W_UNKNOWN=-1};
+
+    /** weight band seen as a raster, whatever its backing */
+    struct weight_band_ref {
+        const weight_map& wm;
+        float operator[](size_t idx) const {
+            return wm.get_weight(idx);
+        }
+    };
+
+    /** setup the weight band from the terrains meta-data */
+    void _setup();
+
+    friend std::vector<weight_map> make_weight_maps(
+        std::shared_ptr<const gdalwrap::gdal> terrains,
+        const std::vector<robot_model>& robots);
 public:
-    weight_map() {}
-    weight_map(const gdalwrap::gdal& _map) {
+    weight_map() : terrains(new gdalwrap::gdal()) {}
+    weight_map(const gdalwrap::gdal& _map) : terrains(new gdalwrap::gdal()) {
         map = _map;
     }
     weight_map(const std::string& f_region, const std::string& f_robot_model) {
@@ -48,21 +90,121 @@ public:
      *
      */
     void load(const std::string& f_region, const std::string& f_robot_model) {
-        terrains.load(f_region);
+        std::shared_ptr<gdalwrap::gdal> region(new gdalwrap::gdal());
+        region->load(f_region);
+        terrains = region;
         rmdl.load(f_robot_model);
         _load();
     }
     virtual void _load();
 
+    /** load region and robot model, streaming the region
+     *
+     * the region is read block by block, each block being blended into the
+     * weight band right away: only a couple of blocks of the bands used by
+     * the cost model are in memory, next to the weight band.
+     * The terrains are not kept (set_robot can not re-blend them).
+     *
+     * @param f_region path to a region.tif file
+     * @param f_robot_model path to a robot model
+     */
+    void load_streamed(const std::string& f_region,
+                       const std::string& f_robot_model);
+
+    /** replace the float weight band by a quantized one
+     *
+     * 8 or 16 bits codes with a decode table, lossless up to 2^bits
+     * distinct weights (see quantized_raster). Read the weights with
+     * get_weight (get_weight_band throws).
+     *
+     * This only shrinks the weight map in memory: a nav_graph built from
+     * it still copies float weights into its edges.
+     */
+    void quantize(size_t bits = 8) {
+        if (weight_tiles)
+            throw std::runtime_error("[weight_map] weight band is memory-mapped");
+        quantized.reset(new quantized_raster(map.bands[0], bits));
+        gdalwrap::raster().swap(map.bands[0]); // release the float band
+        pyramid.clear();
+    }
+    const quantized_raster* get_quantized() const {
+        return quantized.get();
+    }
+
+    /** map with a float weight band, whatever the band backing */
+    gdalwrap::gdal get_decoded_map() const {
+        if (not weight_tiles and not quantized)
+            return map;
+        gdalwrap::gdal decoded = map;
+        decoded.set_size(1, get_width(), get_height());
+        decoded.names[0] = "WEIGHT";
+        gdalwrap::raster& band = decoded.bands[0];
+        for (size_t y = 0, idx = 0; y < get_height(); y++)
+            for (size_t x = 0; x < get_width(); x++, idx++)
+                band[idx] = get_weight(x, y);
+        return decoded;
+    }
+
+    /** save the weight band in the tiled layout of mapped_raster */
+    void save_mapped(const std::string& filepath) const {
+        mapped_raster::save(get_decoded_map(), {"WEIGHT"}, filepath);
+    }
+
+    /** back the weight band by a file written by save_mapped
+     *
+     * the file is memory-mapped read-only: processes loading the same file
+     * share its pages, and only the pages read are loaded.
+     * Read the weights with get_weight (get_weight_band throws).
+     */
+    void load_mapped(const std::string& filepath) {
+        mapped.reset(new mapped_raster(filepath));
+        weight_tiles = &mapped->get_band("WEIGHT");
+        quantized.reset();
+        pyramid.clear();
+        map = mapped->get_meta();
+        width = map.get_width();
+        terrains.reset(new gdalwrap::gdal());
+    }
+
+    /** switch to another robot model
+     *
+     * re-blend the weights from the terrains already loaded,
+     * the region is not read again.
+     */
+    void set_robot(const robot_model& robot) {
+        rmdl = robot;
+        _load();
+    }
+
+    /** inflate obstacles by the robot radius
+     *
+     * uses an exact euclidean distance transform of the obstacles,
+     * linear in the number of pixels whatever the radius.
+     * Known cells closer than the robot radius to an obstacle become
+     * obstacles; with a falloff (in meters) the cells up to
+     * radius + falloff get their weight scaled from x2 down to x1.
+     *
+     * called by _load when the robot model has "inflate" set.
+     */
+    void inflate_obstacles(double falloff = 0);
+
     //TODO, this is not a merge !
     void merge(const weight_map& _wm) {
         map = _wm.get_map();
+        mapped = _wm.mapped;
+        weight_tiles = _wm.weight_tiles;
+        quantized = _wm.quantized;
+        pyramid = _wm.pyramid;
     }
 
     /**
      * NOTE: Don't forget to set_transform GeoData
      */
     gdalwrap::raster& setup_weight_band(size_t width, size_t height) {
+        mapped.reset();
+        weight_tiles = nullptr;
+        quantized.reset();
+        pyramid.clear();
         map.set_size(1, width, height);
         map.names[0] = "WEIGHT";
         return map.bands[0];
@@ -80,26 +222,85 @@ public:
     }
 
     const gdalwrap::raster& get_weight_band() const {
+        if (weight_tiles)
+            throw std::runtime_error("[weight_map] weight band is memory-mapped");
+        if (quantized)
+            throw std::runtime_error("[weight_map] weight band is quantized");
         return map.bands[0];
     }
 
+    /** weight at index (x + y * width), whatever the band backing */
+    float get_weight(size_t idx) const {
+        if (weight_tiles)
+            return (*weight_tiles)[idx];
+        if (quantized)
+            return (*quantized)[idx];
+        return map.bands[0][idx];
+    }
+    /** weight of pixel (x, y), no index split (div/mod) on memory-mapped
+     * tiles: prefer it when walking the band by rows */
+    float get_weight(size_t x, size_t y) const {
+        if (weight_tiles)
+            return weight_tiles->at(x, y);
+        return get_weight(x + y * get_width());
+    }
+
+    /** overview pyramid of the weight band (min, max and mean)
+     *
+     * built in parallel on the first call and cached, reset when the band
+     * is replaced. Unknown weights (< 0) and obstacles (+inf) are reduced
+     * like any value: a max cell is an obstacle if any of its pixels is.
+     * The first call must not race with other calls.
+     */
+    const raster_pyramid& get_pyramid() const {
+        if (pyramid.empty())
+            pyramid.build(weight_band_ref{*this}, get_width(), get_height());
+        return pyramid;
+    }
+
+    /** refresh the pyramid after the weights changed in [x0, x1) x [y0, y1)
+     *
+     * only the overview cells covering the area are recomputed.
+     */
+    void update_pyramid(size_t x0, size_t y0, size_t x1, size_t y1) {
+        if (pyramid.empty())
+            return; // built from scratch on the next get_pyramid
+        pyramid.update(weight_band_ref{*this}, x0, y0, x1, y1);
+    }
+
     /** handy method to display the weight-map
      */
     std::vector<unsigned char> get_weight_band_uchar() const {
-        const auto& weight = map.bands[0];
-        std::vector<unsigned char> retval(weight.size());
-        for (size_t idx = 0; idx < weight.size(); idx++) {
-            const auto& val = weight[idx];
-            if (val < 0)
-                retval[idx] = 0;
-            else if (val == std::numeric_limits<float>::infinity())
-                retval[idx] = 255;
-            else
-                retval[idx] = std::floor(val * 5.0);
-        }
+        std::vector<unsigned char> retval(get_width() * get_height());
+        for (size_t y = 0, idx = 0; y < get_height(); y++)
+            for (size_t x = 0; x < get_width(); x++, idx++)
+                retval[idx] = weight_to_uchar(get_weight(x, y));
+        return retval;
+    }
+
+    /** display a pyramid level, obstacles kept by the max reduction
+     *
+     * level 0 is the full resolution band.
+     */
+    std::vector<unsigned char> get_weight_band_uchar(size_t level,
+            const std::string& reduction = "max") const {
+        if (level == 0)
+            return get_weight_band_uchar();
+        const gdalwrap::raster& band = get_pyramid().get_level(level).get(reduction);
+        std::vector<unsigned char> retval(band.size());
+        for (size_t idx = 0; idx < retval.size(); idx++)
+            retval[idx] = weight_to_uchar(band[idx]);
         return retval;
     }
 
+    static unsigned char weight_to_uchar(float val) {
+        if (val < 0)
+            return 0;
+        if (val == std::numeric_limits<float>::infinity())
+            return 255;
+        return std::floor(val * 5.0);
+    }
+
     const gdalwrap::gdal& get_map() const {
         return map;
     }
@@ -107,7 +308,7 @@ public:
         return map;
     }
     const gdalwrap::gdal& get_region() const {
-        return terrains;
+        return *terrains;
     }
     const robot_model& get_robot() const {
         return rmdl;
@@ -144,8 +345,25 @@ public:
     size_t index_utm( const point_xy_t& p ) const {
         return map.index_utm(p[0], p[1]);
     }
+
+    /** transform of the map, read once to work in pixels
+     *
+     * NOTE: get it again after changing the map transform
+     */
+    pixel_transform get_pixel_transform() const {
+        return pixel_transform(map);
+    }
+    pixel_t pixel( const point_xy_t& p ) const {
+        return get_pixel_transform().pixel_custom(p);
+    }
+    pixel_t pixel_utm( const point_xy_t& p ) const {
+        return get_pixel_transform().pixel_utm(p);
+    }
+    size_t index_pix( const pixel_t& px ) const {
+        return px[0] + px[1] * get_width();
+    }
     void save(const std::string& filepath) const {
-        map.save(filepath);
+        get_decoded_map().save(filepath);
     }
 };
 
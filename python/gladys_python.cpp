@@ -118,6 +118,13 @@ static bool py_gladys_can_communicate(gladys::gladys& self,  bpy::tuple start, b
     return self.can_communicate(_start, _goal);
 }
 
+static bool py_gladys_can_communicate_cell(gladys::gladys& self,  bpy::tuple start, bpy::tuple goal){
+    gladys::point_xy_t _start = {bpy::extract<double>(start[0]), bpy::extract<double>(start[1])};
+    gladys::point_xy_t _goal  = {bpy::extract<double>(goal[0]),  bpy::extract<double>(goal[1])};
+
+    return self.can_communicate_cell(_start, _goal);
+}
+
 static bpy::list py_gladys_single_source_all_costs(gladys::gladys& self,  bpy::tuple start, bpy::list goals){
     bpy::list retval;
 
@@ -206,6 +213,56 @@ static bpy::list py_weight_map_get_weight_band_uchar(gladys::weight_map& self) {
     return std_vector_to_py_list( self.get_weight_band_uchar() );
 }
 
+static bpy::list py_weight_map_get_weight_band_uchar_level(gladys::weight_map& self,
+        size_t level, const std::string& reduction) {
+    return std_vector_to_py_list( self.get_weight_band_uchar(level, reduction) );
+}
+
+static bpy::tuple py_pyramid_get_size(const gladys::raster_pyramid& pyramid, size_t level) {
+    if (level == 0)
+        return bpy::make_tuple(pyramid.get_width(), pyramid.get_height());
+    const gladys::pyramid_level& l = pyramid.get_level(level);
+    return bpy::make_tuple(l.width, l.height);
+}
+
+static size_t py_weight_map_get_pyramid_levels(gladys::weight_map& self) {
+    return self.get_pyramid().size();
+}
+
+static bpy::tuple py_weight_map_get_pyramid_size(gladys::weight_map& self, size_t level) {
+    return py_pyramid_get_size(self.get_pyramid(), level);
+}
+
+static bpy::list py_weight_map_get_pyramid_level(gladys::weight_map& self,
+        size_t level, const std::string& reduction) {
+    if (level == 0) {
+        // the band itself, whatever its storage (mapped, quantized)
+        gladys::pyramid_level().get(reduction); // throw if unknown
+        std::vector<float> band(self.get_width() * self.get_height());
+        for (size_t idx = 0; idx < band.size(); idx++)
+            band[idx] = self.get_weight(idx);
+        return std_vector_to_py_list(band);
+    }
+    return std_vector_to_py_list( self.get_pyramid().get_level(level).get(reduction) );
+}
+
+static size_t py_visibility_map_get_pyramid_levels(gladys::visibility_map& self) {
+    return self.get_pyramid().size();
+}
+
+static bpy::tuple py_visibility_map_get_pyramid_size(gladys::visibility_map& self, size_t level) {
+    return py_pyramid_get_size(self.get_pyramid(), level);
+}
+
+static bpy::list py_visibility_map_get_pyramid_level(gladys::visibility_map& self,
+        size_t level, const std::string& reduction) {
+    if (level == 0) { // Z_MAX itself, throw if memory-mapped
+        gladys::pyramid_level().get(reduction); // throw if unknown
+        return std_vector_to_py_list( self.get_heightmap() );
+    }
+    return std_vector_to_py_list( self.get_pyramid().get_level(level).get(reduction) );
+}
+
 // Python requires an exported function called init<module-name> in every
 // extension module. This is where we build the module contents.
 BOOST_PYTHON_MODULE(libgladys_python)
@@ -255,6 +312,12 @@ BOOST_PYTHON_MODULE(libgladys_python)
         .def("get_map", &py_weight_map_get_map)
         .def("get_region", &py_weight_map_get_region)
         .def("get_weight_band_uchar", &py_weight_map_get_weight_band_uchar)
+        // weight_map::get_weight_band_uchar of a pyramid level
+        .def("get_weight_band_uchar", &py_weight_map_get_weight_band_uchar_level)
+        // weight_map::get_pyramid, level 0 being the full resolution
+        .def("get_pyramid_levels", &py_weight_map_get_pyramid_levels)
+        .def("get_pyramid_size", &py_weight_map_get_pyramid_size)
+        .def("get_pyramid_level", &py_weight_map_get_pyramid_level)
         ;
     bpy::class_<gladys::costmap, bpy::bases<gladys::weight_map>>("costmap",
         bpy::init<std::string, std::string>());
@@ -265,6 +328,10 @@ BOOST_PYTHON_MODULE(libgladys_python)
     // visibility_map
     bpy::class_<gladys::visibility_map>("visibility_map", bpy::init<std::string, std::string>())
         .def("is_visible", &py_visibility_map_is_visible)
+        // visibility_map::get_pyramid of Z_MAX, level 0 being Z_MAX
+        .def("get_pyramid_levels", &py_visibility_map_get_pyramid_levels)
+        .def("get_pyramid_size", &py_visibility_map_get_pyramid_size)
+        .def("get_pyramid_level", &py_visibility_map_get_pyramid_level)
         ;
 
     //gladys
@@ -272,6 +339,9 @@ BOOST_PYTHON_MODULE(libgladys_python)
         .def("navigation", &py_gladys_navigation)
         .def("is_visible", &py_gladys_is_visible)
         .def("can_communicate", &py_gladys_can_communicate)
+        .def("can_communicate_cell", &py_gladys_can_communicate_cell)
+        .def("enable_visibility_cache", &gladys::gladys::enable_visibility_cache)
+        .def("disable_visibility_cache", &gladys::gladys::disable_visibility_cache)
         .def("single_source_all_costs", &py_gladys_single_source_all_costs)
         .def("get_closest_point", &py_gladys_get_closest_point)
         ;
@@ -0,0 +1,134 @@
+/*
+ * adaptive_astar.cpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-18
+ * license: BSD
+ */
+#include <queue>
+#include <limits>
+#include <utility>
+#include <functional>
+
+#include "gladys/adaptive_astar.hpp"
+
+namespace gladys {
+
+namespace {
+
+// heuristic reading the learnt values
+class adaptive_heuristic : public boost::astar_heuristic<graph_t, double> {
+    const adaptive_astar& planner;
+public:
+    adaptive_heuristic(const adaptive_astar& _planner) : planner(_planner) {}
+
+    double operator()(const vertex_t& u) {
+        return planner.h(u);
+    }
+};
+
+// goal visitor counting the expanded vertices
+class adaptive_visitor : public boost::default_astar_visitor {
+    vertex_t goal;
+    size_t* expanded;
+public:
+    adaptive_visitor(vertex_t _goal, size_t* _expanded)
+        : goal(_goal), expanded(_expanded) {}
+
+    void examine_vertex(vertex_t u, const graph_t&) {
+        if (u == goal)
+            throw found_goal(u);
+        (*expanded)++;
+    }
+};
+
+} // namespace
+
+adaptive_astar::adaptive_astar(const graph_t& g, const vertex_t& goal) :
+    g(g), goal(goal), t(0), h_values(boost::num_vertices(g), -1.0),
+    cost(std::numeric_limits<double>::infinity()), expanded(0)
+{
+    h_values[goal] = 0;
+}
+
+void adaptive_astar::restore_consistency() {
+    if (t == 0)
+        return; // nothing learnt yet
+
+    typedef std::pair<double, vertex_t> item_t;
+    std::priority_queue<item_t, std::vector<item_t>, std::greater<item_t> > open;
+
+    // lower h(u) if going through v is now shorter
+    auto relax = [&](const vertex_t& u, const vertex_t& v, float weight) {
+        if (u == goal)
+            return;
+        double hv = h(v) + weight;
+        if (h(u) > hv) {
+            h_values[u] = hv;
+            open.push(item_t(hv, u));
+        }
+    };
+
+    boost::graph_traits<graph_t>::edge_iterator ei, ei_end;
+    for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei)
+        if (g[*ei].t >= t) {
+            vertex_t u = boost::source(*ei, g), v = boost::target(*ei, g);
+            relax(u, v, g[*ei].weight);
+            relax(v, u, g[*ei].weight);
+        }
+
+    while (!open.empty()) {
+        item_t top = open.top();
+        open.pop();
+        if (top.first > h_values[top.second])
+            continue; // outdated entry
+        boost::graph_traits<graph_t>::out_edge_iterator oi, oi_end;
+        for (boost::tie(oi, oi_end) = boost::out_edges(top.second, g);
+             oi != oi_end; ++oi)
+            relax(boost::target(*oi, g), top.second, g[*oi].weight);
+    }
+}
+
+path_t adaptive_astar::search(const vertex_t& start) {
+    restore_consistency();
+    t = std::time(0);
+
+    path_t shortest_path;
+    expanded = 0;
+    cost = std::numeric_limits<double>::infinity();
+
+    adaptive_visitor vis(goal, &expanded);
+    adaptive_heuristic heuristic(*this);
+    std::vector<vertex_t> predecessors(boost::num_vertices(g));
+    std::vector<double> distances(boost::num_vertices(g));
+    std::vector<double> ranks(boost::num_vertices(g), -1.0);
+    std::vector<boost::default_color_type> colors(boost::num_vertices(g));
+    try {
+        boost::astar_search(
+            g, start, heuristic,
+            boost::predecessor_map(predecessors.data()).
+                distance_map(distances.data()).
+                weight_map(boost::get(&edge::weight, g)).
+                rank_map(ranks.data()).
+                color_map(colors.data()).
+                visitor(vis)
+        );
+    } catch (found_goal) {
+        for(vertex_t v = goal;; v = predecessors[v]) {
+            shortest_path.push_front(g[v].pt);
+            if (predecessors[v] == v)
+                break;
+        }
+        cost = distances[goal];
+
+        // learn from the closed list
+        for (size_t v = 0; v < colors.size(); v++)
+            if (colors[v] == boost::black_color)
+                h_values[v] = cost - distances[v];
+    }
+    return shortest_path;
+}
+
+} // namespace gladys
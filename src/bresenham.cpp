@@ -8,8 +8,6 @@
  * license: BSD
  */
 
-#include <cmath>
-
 #include "gladys/bresenham.hpp"
 
 namespace gladys {
@@ -43,54 +41,11 @@ points_t bresenham( const point_xy_t& s, const point_xy_t& t) {//{{{
  *
  */
 
-    /* init */
     points_t line ;
-    int x0 = s[0] ;
-    int y0 = s[1] ;
-    int x1 = t[0] ;
-    int y1 = t[1] ;
-
-    bool steep = ( abs(y1 - y0) > abs(x1 - x0) ) ;
-    if ( steep ) {
-        std::swap(x0, y0) ;
-        std::swap(x1, y1) ;
-    }
-
-    int deltax = abs(x1 - x0) ;
-    int deltay = abs(y1 - y0) ;
-    int error = deltax / 2 ;
-    int y = y0 ;
-
-    int ystep   = ( y0 < y1 ? 1 : -1 );
-
-    /* line */
-    if ( x0 < x1 ) // ascending
-        for ( int x = x0 ; x <= x1 ; x++ ) { 
-            if ( steep )
-                line.push_back( point_xy_t { (double) y, (double) x } ) ;
-            else
-                line.push_back( point_xy_t { (double) x, (double) y } ) ;
-            // progression control
-            error -= deltay ;
-            if ( error < 0 ) {
-                y += ystep ;
-                error += deltax ;
-            }
-        }
-    else //descending
-        for ( int x = x0 ; x >= x1 ; x-- ) { 
-            if ( steep )
-                line.push_back( point_xy_t { (double) y, (double) x } ) ;
-            else
-                line.push_back( point_xy_t { (double) x, (double) y } ) ;
-            // progression control
-            error -= deltay ;
-            if ( error < 0 ) {
-                y += ystep ;
-                error += deltax ;
-            }
-        }
-    /* result */
+    bresenham_walk( (int) s[0], (int) s[1], (int) t[0], (int) t[1], [&line](int x, int y) -> bool {
+        line.push_back( point_xy_t { (double) x, (double) y } ) ;
+        return true ;
+    });
     return line ;
 }//}}}
 
@@ -9,29 +9,195 @@
  */
 #include "gladys/dstar.hpp"
 #include <boost/graph/graphviz.hpp>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <chrono>
 #include <limits>
 #include <iostream>
 
 
 namespace gladys {
 
+    namespace {
+        const char snapshot_magic[8] = {'G','L','D','S','D','S','T','R'};
+        const uint32_t snapshot_format = 1;
+
+        template <typename T>
+        void write_pod(std::ostream& os, const T& value)
+        {
+            os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        T read_pod(std::istream& is)
+        {
+            T value;
+            is.read(reinterpret_cast<char*>(&value), sizeof(T));
+            if (!is)
+                throw std::runtime_error("[dstar] truncated snapshot");
+            return value;
+        }
+
+        // snapshot file opened for reading, usable as a temporary
+        struct snapshot_file : std::ifstream {
+            snapshot_file(const std::string& filepath) :
+                std::ifstream(filepath, std::ios::binary)
+            {
+                if (!*this)
+                    throw std::runtime_error("[dstar] cannot open " + filepath);
+            }
+            std::istream& stream() {
+                return *this;
+            }
+        };
+
+        // FNV-1a
+        void hash_bytes(uint64_t& hash, const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash ^= bytes[i];
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+
+    const dstar_search::cost dstar_search::cost_table::unknown = {
+        std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::infinity()
+    };
+
+    dstar_search::cost_table::cost_table(size_t size, bool is_sparse):
+        is_sparse(is_sparse)
+    {
+        if (!is_sparse)
+            dense.assign(size, unknown);
+    }
+
     dstar_search::dstar_search(const graph_t& g, const vertex_t& start, 
-                                                 const vertex_t& goal):
+                                                 const vertex_t& goal,
+                                                 const dstar_limits& limits):
         g(g), start(start), goal(goal), last(start), t(std::time(0)),
-        costs(boost::num_vertices(g), 
-              {std::numeric_limits<float>::infinity(),
-               std::numeric_limits<float>::infinity()}
-              ), km(0)
+        limits(limits), costs(boost::num_vertices(g), limits.sparse), km(0),
+        complete(false)
     {
         costs[goal].rhs = 0;
         pq.insert(bm_value(goal, calc_key(goal)));
         compute_shortest_path();
     }
 
+    dstar_search::dstar_search(const graph_t& g, std::istream& is,
+                                                 const dstar_limits& limits):
+        g(g), limits(limits), costs(boost::num_vertices(g), limits.sparse)
+    {
+        char magic[sizeof(snapshot_magic)];
+        is.read(magic, sizeof(magic));
+        if (!is or !std::equal(magic, magic + sizeof(magic), snapshot_magic) or
+            read_pod<uint32_t>(is) != snapshot_format)
+            throw std::runtime_error("[dstar] not a dstar snapshot");
+        if (read_pod<uint64_t>(is) != graph_version(g))
+            throw std::runtime_error("[dstar] snapshot taken on another graph");
+
+        size_t n = boost::num_vertices(g);
+        start = read_pod<uint64_t>(is);
+        goal  = read_pod<uint64_t>(is);
+        last  = read_pod<uint64_t>(is);
+        t     = read_pod<int64_t>(is);
+        km    = read_pod<float>(is);
+        complete = read_pod<uint8_t>(is);
+        if (start >= n or goal >= n or last >= n)
+            throw std::runtime_error("[dstar] corrupted snapshot");
+
+        for (uint64_t i = read_pod<uint64_t>(is); i > 0; i--) {
+            vertex_t v = read_pod<uint64_t>(is);
+            if (v >= n)
+                throw std::runtime_error("[dstar] corrupted snapshot");
+            cost& c = costs[v];
+            c.g   = read_pod<float>(is);
+            c.rhs = read_pod<float>(is);
+        }
+        for (uint64_t i = read_pod<uint64_t>(is); i > 0; i--) {
+            vertex_t v = read_pod<uint64_t>(is);
+            if (v >= n)
+                throw std::runtime_error("[dstar] corrupted snapshot");
+            key_t k;
+            k.first  = read_pod<float>(is);
+            k.second = read_pod<float>(is);
+            pq.insert(bm_value(v, k));
+        }
+    }
+
+    dstar_search::dstar_search(const graph_t& g, const std::string& filepath,
+                                                 const dstar_limits& limits):
+        dstar_search(g, snapshot_file(filepath).stream(), limits)
+    {
+    }
+
+    void
+    dstar_search::save(std::ostream& os) const
+    {
+        os.write(snapshot_magic, sizeof(snapshot_magic));
+        write_pod<uint32_t>(os, snapshot_format);
+        write_pod<uint64_t>(os, graph_version(g));
+        write_pod<uint64_t>(os, start);
+        write_pod<uint64_t>(os, goal);
+        write_pod<uint64_t>(os, last);
+        write_pod<int64_t>(os, t);
+        write_pod<float>(os, km);
+        write_pod<uint8_t>(os, complete);
+
+        uint64_t count = 0;
+        costs.for_each([&count](const vertex_t&, const cost&) { count++; });
+        write_pod<uint64_t>(os, count);
+        costs.for_each([&os](const vertex_t& v, const cost& c) {
+            write_pod<uint64_t>(os, v);
+            write_pod<float>(os, c.g);
+            write_pod<float>(os, c.rhs);
+        });
+
+        write_pod<uint64_t>(os, pq.size());
+        for (bm_type::right_const_iterator i = pq.right.begin(),
+             iend = pq.right.end(); i != iend; ++i) {
+            write_pod<uint64_t>(os, i->second);
+            write_pod<float>(os, i->first.first);
+            write_pod<float>(os, i->first.second);
+        }
+    }
+
+    void
+    dstar_search::save(const std::string& filepath) const
+    {
+        std::ofstream os(filepath, std::ios::binary);
+        save(os);
+        if (!os)
+            throw std::runtime_error("[dstar] cannot write " + filepath);
+    }
+
+    uint64_t
+    dstar_search::graph_version(const graph_t& g)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        uint64_t n = boost::num_vertices(g), m = boost::num_edges(g);
+        hash_bytes(hash, &n, sizeof(n));
+        hash_bytes(hash, &m, sizeof(m));
+
+        boost::graph_traits<graph_t>::vertex_iterator vi, vi_end;
+        for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi)
+            hash_bytes(hash, g[*vi].pt.data(), sizeof(point_xy_t));
+
+        boost::graph_traits<graph_t>::edge_iterator ei, ei_end;
+        for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
+            uint64_t ends[2] = {boost::source(*ei, g), boost::target(*ei, g)};
+            hash_bytes(hash, ends, sizeof(ends));
+        }
+        return hash;
+    }
+
     dstar_search::key_t 
     dstar_search::calc_key(const vertex_t& v) const
     {
-        const cost& c = costs[v];
+        const cost& c = costs.get(v);
         float min = std::min(c.rhs, c.g);
         return std::make_pair(min + h(start, v) + km, min);
     }
@@ -44,7 +210,7 @@ namespace gladys {
             float min = std::numeric_limits<float>::infinity();
             boost::graph_traits<graph_t>::out_edge_iterator ei,ei_end;
             for (boost::tie(ei,ei_end) = boost::out_edges(v, g); ei != ei_end; ++ei) 
-                min = std::min(min, g[*ei].weight + costs[target(*ei, g)].g);
+                min = std::min(min, g[*ei].weight + costs.get(target(*ei, g)).g);
             c.rhs = min;
         }
 
@@ -58,10 +224,24 @@ namespace gladys {
     void
     dstar_search::compute_shortest_path() 
     {
-        int i = 0;
-        while (pq.right.begin()->first < calc_key(start) or 
-               costs[start].rhs != costs[start].g)
+        typedef std::chrono::steady_clock clock;
+        clock::time_point deadline = clock::now() +
+            std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(limits.max_duration));
+
+        size_t i = 0;
+        complete = false;
+        while (not pq.empty() and
+               (pq.right.begin()->first < calc_key(start) or
+                costs.get(start).rhs != costs.get(start).g))
         {
+            // budget check, the clock is only read every 64 expansions
+            if (limits.max_expansions > 0 and i >= limits.max_expansions)
+                return;
+            if (limits.max_duration > 0 and i % 64 == 0 and
+                clock::now() > deadline)
+                return;
+
             auto it = pq.right.begin();
             key_t kold = it->first;
             vertex_t v = it->second;
@@ -91,7 +271,9 @@ namespace gladys {
             ++i;
         }
 
-        if (pq.empty()) throw no_path();
+        complete = true;
+        if (costs.get(start).g == std::numeric_limits<float>::infinity())
+            throw no_path();
     }
     
     float
@@ -104,8 +286,11 @@ namespace gladys {
     path_t 
     dstar_search::get_path() const
     {
+        if (not complete)
+            return get_best_effort_path();
+
         path_t res;
-        if (costs[last].g == std::numeric_limits<float>::infinity())
+        if (costs.get(last).g == std::numeric_limits<float>::infinity())
             throw no_path();
 
         res.push_back(g[last].pt);
@@ -115,17 +300,57 @@ namespace gladys {
             boost::graph_traits<graph_t>::out_edge_iterator ei,ei_end;
             boost::tie(ei, ei_end) = boost::out_edges(v, g);
             vertex_t best_v = boost::target(*ei, g);
-            float min = g[*ei].weight + costs[best_v].g;
+            float min = g[*ei].weight + costs.get(best_v).g;
             ++ ei;
             for (; ei != ei_end; ++ei) {
                 vertex_t v1 = boost::target(*ei, g);
-                float c = g[*ei].weight + costs[v1].g;
+                float c = g[*ei].weight + costs.get(v1).g;
+                if (min > c) {
+                    min = c;
+                    best_v = v1;
+                }
+            }
+            v = best_v;
+            res.push_back(g[v].pt);
+        }
+
+        return res;
+    }
+
+    path_t
+    dstar_search::get_best_effort_path() const
+    {
+        /* Greedy descent from the current position: use min(g, rhs) where the
+         * search already reached, else the euclidean distance to the goal.
+         * Each vertex is visited once, so it stops at a dead end. */
+        path_t res;
+        res.push_back(g[last].pt);
+
+        std::unordered_set<vertex_t> visited;
+        visited.insert(last);
+        vertex_t v = last;
+        while (v != goal) {
+            float min = std::numeric_limits<float>::infinity();
+            vertex_t best_v = v;
+            boost::graph_traits<graph_t>::out_edge_iterator ei,ei_end;
+            for (boost::tie(ei,ei_end) = boost::out_edges(v, g); ei != ei_end; ++ei) {
+                vertex_t v1 = boost::target(*ei, g);
+                if (visited.count(v1))
+                    continue;
+                const cost& c1 = costs.get(v1);
+                float estimate = std::min(c1.g, c1.rhs);
+                if (estimate == std::numeric_limits<float>::infinity())
+                    estimate = h(v1, goal);
+                float c = g[*ei].weight + estimate;
                 if (min > c) {
                     min = c;
                     best_v = v1;
                 }
             }
+            if (best_v == v)
+                break; // dead end
             v = best_v;
+            visited.insert(v);
             res.push_back(g[v].pt);
         }
 
@@ -155,12 +380,12 @@ namespace gladys {
     void
     dstar_search::write_graphviz(std::ostream& os) const
     {
-        std::vector<std::string> vert_label(costs.size());
+        std::vector<std::string> vert_label(boost::num_vertices(g));
         boost::graph_traits<graph_t>::vertex_iterator vi,vi_end;
         boost::tie(vi, vi_end) = boost::vertices(g);
         for (; vi != vi_end; ++vi) {
             std::ostringstream oss;
-            const cost& c = costs[*vi];
+            const cost& c = costs.get(*vi);
             oss << "pt " << g[*vi].pt << " g: " << c.g << " rhs: " << c.rhs;
             vert_label[*vi] = oss.str();
         }
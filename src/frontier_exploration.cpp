@@ -13,6 +13,7 @@
 #include <ostream>      // output stream
 #include <stdexcept>    // exceptions
 #include <deque>
+#include <algorithm>
 #include <vector>
 #include <cmath>        // for round()
 
@@ -53,22 +54,40 @@ namespace gladys {
                     << x_max << ", " << y_max << ") "
                     << std::endl;
 
+        // the focused area in pixels: from x_min to x_max - 1 (utm)
+        pixels = map.get_pixel_transform();
+        auto pixel_bounds = [](double lo, double hi, double origin,
+                double scale, size_t size, long& p_min, long& p_max) {
+            double a = (lo - origin) / scale, b = (hi - 1 - origin) / scale;
+            p_min = std::max( 0L, long(std::ceil( std::min(a, b) )) );
+            p_max = std::min( long(size) - 1, long(std::floor( std::max(a, b) )) );
+        };
+        pixel_bounds( x_min, x_max, map.get_utm_pose_x(), pixels.get_scale_x(),
+                      width, px_min, px_max );
+        pixel_bounds( y_min, y_max, map.get_utm_pose_y(), pixels.get_scale_y(),
+                      height, py_min, py_max );
+
         // Deal with rounded value (ease the checks for position)
-        point_xy_t seed {std::round(_seed[0]), std::round(_seed[1]) };
+        point_xy_t rseed {std::round(_seed[0]), std::round(_seed[1]) };
+        pixel_t pseed = pixels.pixel_utm( rseed );
 
-        std::cerr   << "[Frontier] seed is ("<<seed[0] <<","<<seed[1] 
-                    << ") ; index_utm is " << map.index_utm( seed )
-                    << " in map (" << width << "," << height << ")." 
+        std::cerr   << "[Frontier] seed is ("<<rseed[0] <<","<<rseed[1] 
+                    << ") ; pixel is (" << pseed[0] << "," << pseed[1]
+                    << ") in map (" << width << "," << height << ")." 
                     << std::endl;
 
         // Check conditions on seed :
         // - within the known area and not an obstacle
+        if ( !pixels.contains( pseed ) )
+            throw std::runtime_error("[Frontier] The seed is out of the map : \
+                unable to compute frontiers") ;
+        size_t seed = pixels.index( pseed );
         std::cerr   << "[Frontier] data has size : " 
-                    << data.size() << std::endl;
-        std::cerr   << "[Frontier] data[index_utm(seed)] = " 
-                    << data[ map.index_utm( seed ) ] << std::endl;
-        if ( data[ map.index_utm( seed ) ] < 0
-        ||   map.is_obstacle(data[ map.index_utm( seed ) ]) ){
+                    << map.get_width() * map.get_height() << std::endl;
+        std::cerr   << "[Frontier] data[seed] = " 
+                    << map.get_weight( seed ) << std::endl;
+        if ( map.get_weight( seed ) < 0
+        ||   map.is_obstacle(map.get_weight( seed )) ){
             throw std::runtime_error("[Frontier] The seed is unknown or \
                 obstacle : unable to compute frontiers  \
                 (and yes, it's a feature! XD )") ;
@@ -78,13 +97,17 @@ namespace gladys {
          *
          * Use the description given by :
          * "Robot Exploration with Fast Frontier Detection : Theory and
-         * Experiments", M. Keidar afd G. A. Kaminka (AAMAS 2012)
+         * Experiments", M. Keidar afd G. A. Kaminka (AAMAS 2012)
          *
+         * The wavefront works on pixel indices (x + y * width), the
+         * frontier points are stored in utm as the rounded seed moved by
+         * whole cells (not the pixel centers, which differ from it on a
+         * map whose origin is not on integer coordinates).
          */
         // Requested containers
         // queues
-        std::deque< point_xy_t > mQueue ; // std::queue are restricted std::deque
-        std::deque< point_xy_t > fQueue ; // std::queue are restricted std::deque
+        std::deque< size_t > mQueue ; // std::queue are restricted std::deque
+        std::deque< size_t > fQueue ; // std::queue are restricted std::deque
 
         // markers lists
         std::vector< bool > mapOpenList       (height*width, false) ;
@@ -92,13 +115,16 @@ namespace gladys {
         std::vector< bool > frontierOpenList  (height*width, false) ;
         std::vector< bool > frontierCloseList (height*width, false) ;
 
-        // points
-        point_xy_t p,q ;
+        // pixels of the last frontier, and neighbours (reused)
+        std::vector< size_t > lastFrontier, neighbours ;
+
+        // pixels
+        size_t p,q ;
 
         //init
         frontiers.empty();    // clear the previous frontiers
         mQueue.push_back( seed );
-        mapOpenList[ map.index_utm( seed )] = true ;
+        mapOpenList[ seed ] = true ;
 
         // Main while over queued map points
         while ( !mQueue.empty() ) {
@@ -107,7 +133,7 @@ namespace gladys {
             mQueue.pop_front();
 
             // if p has already been visited, then continue
-            if ( mapCloseList[ map.index_utm( p )] ) {
+            if ( mapCloseList[ p ] ) {
                 continue ;
             }
 
@@ -118,9 +144,10 @@ namespace gladys {
                 fQueue.clear();
                 // create a new frontier
                 frontiers.push_back( points_t() );
+                lastFrontier.clear();
 
                 fQueue.push_back( p );
-                frontierOpenList[ map.index_utm( p )] = true ;
+                frontierOpenList[ p ] = true ;
 
                 // while over potential frontier points
                 while ( !fQueue.empty() ) {
@@ -129,8 +156,8 @@ namespace gladys {
                     fQueue.pop_front();
 
                     // if q has already been visited, then continue
-                    if  ( mapCloseList[ map.index_utm( q ) ]
-                    || frontierCloseList[ map.index_utm( q ) ]) {
+                    if  ( mapCloseList[ q ]
+                    || frontierCloseList[ q ]) {
                         continue;
                     }
 
@@ -141,78 +168,87 @@ namespace gladys {
                         // Note that this is a rough estimation
                         if ( frontiers.back().size() \
                              * (map.get_scale_x() + map.get_scale_y() )/2 \
-                             > frontier_max_size )
+                             > frontier_max_size ) {
                             // create a new frontier
                             frontiers.push_back( points_t() );
+                            lastFrontier.clear();
+                        }
 
-                        frontiers.back().push_back( q );
+                        frontiers.back().push_back( point_xy_t {
+                            rseed[0] + (long(q % width) - pseed[0]) * pixels.get_scale_x(),
+                            rseed[1] + (long(q / width) - pseed[1]) * pixels.get_scale_y() } );
+                        lastFrontier.push_back( q );
                         //for all neighbours of q
-                        for ( auto i : find_neighbours( q ) ) {
+                        find_neighbours( q, neighbours );
+                        for ( auto i : neighbours ) {
                             // if NOT marked yet
-                            if  ( !( mapCloseList[ map.index_utm( i ) ]
-                            || frontierCloseList[ map.index_utm( i ) ]
-                            || frontierOpenList[ map.index_utm( i ) ])) {
+                            if  ( !( mapCloseList[ i ]
+                            || frontierCloseList[ i ]
+                            || frontierOpenList[ i ])) {
                             // then proceed
                                 fQueue.push_back( i );
-                                frontierOpenList[ map.index_utm( i )] = true ;
+                                frontierOpenList[ i ] = true ;
                             }
                         }
                     }
                     // mark q
-                    frontierCloseList[ map.index_utm( q )] = true ;
+                    frontierCloseList[ q ] = true ;
                 }
 
                 // Note : no need to save the new frontier explicitly
 
                 // mark all points of the new frontier in the closed list
-                for ( auto i : frontiers.back() ) {
-                    mapCloseList[ map.index_utm( i )] = true ;
+                for ( auto i : lastFrontier ) {
+                    mapCloseList[ i ] = true ;
                 }
 
             }
 
             //for all neighbours of p
-            for ( auto i : find_neighbours( p ) ){
+            find_neighbours( p, neighbours );
+            for ( auto i : neighbours ){
                 // if NOT marked yet
-                if  ( !( mapCloseList[ map.index_utm( i ) ]
-                || mapOpenList[ map.index_utm( i ) ])
+                if  ( !( mapCloseList[ i ]
+                || mapOpenList[ i ])
                 // and has at least one neighbour in "Open Space", ie a
                 // neighbour in the known area ard which is not an obstacle.
-                && ( ! (data[ map.index_utm( i )] < 0                     // unknown
-                    || map.is_obstacle(data[ map.index_utm( i )]) ))) {   // obstacle
+                && ( ! (map.get_weight( i ) < 0                     // unknown
+                    || map.is_obstacle(map.get_weight( i )) ))) {   // obstacle
                     // then proceed
                     mQueue.push_back( i );
-                    mapOpenList[ map.index_utm( i )] = true ;
+                    mapOpenList[ i ] = true ;
                 }
             }
 
             //mark p
-            mapCloseList[ map.index_utm( p )] = true ;
+            mapCloseList[ p ] = true ;
         }
     }
 
-    bool frontier_detector::is_frontier(  const point_xy_t &p )
+    bool frontier_detector::is_frontier( size_t idx )
     {
 
         // A point is a frontier iff it is in the open space 
         // (i.e. it is know and is not an obstacle )
-        if  ( data[ map.index_utm( p ) ] < 0                // unknown
-        ||   map.is_obstacle( data[ map.index_utm( p )] ))  //obstacle
+        if  ( map.get_weight( idx ) < 0                // unknown
+        ||   map.is_obstacle( map.get_weight( idx ) ))  //obstacle
             return false ;
         // and at least one of is neighbour is unknown.
-        for ( auto i : find_neighbours( p ) )
-            if ( data[ map.index_utm( i ) ] < 0 )           // unknown
+        find_neighbours( idx, frontier_neighbours );
+        for ( auto i : frontier_neighbours )
+            if ( map.get_weight( i ) < 0 )           // unknown
                 return true ;
 
         return false;
     }
 
-    points_t frontier_detector::find_neighbours( const point_xy_t &p )
+    void frontier_detector::find_neighbours( size_t idx,
+            std::vector<size_t>& neighbours )
     {
-        points_t neighbours ;
+        neighbours.clear();
 
-        double delta_x = ng.get_map().get_scale_x();
-        double delta_y = ng.get_map().get_scale_y();
+        size_t width = pixels.get_width();
+        long x = idx % width, y = idx / width;
 
         /* Orientation :
          *
@@ -225,36 +261,36 @@ namespace gladys {
          *  SW  S   SE          (-1,+1)     ( 0,+1)     (+1,+1)
          *
          */
+        bool north = y > py_min, south = y < py_max;
+        bool west  = x > px_min, east  = x < px_max;
 
         // North
-        if ( p[1] > y_min )
-            neighbours.push_back( point_xy_t { p[0]        , p[1]-delta_y } );
+        if ( north )
+            neighbours.push_back( idx - width );
         // South
-        if ( p[1] < y_max-1 )
-            neighbours.push_back( point_xy_t { p[0]        , p[1]+delta_y } );
+        if ( south )
+            neighbours.push_back( idx + width );
         // East
-        if ( p[0] < x_max-1 )
-            neighbours.push_back( point_xy_t { p[0]+delta_x, p[1]         } );
+        if ( east )
+            neighbours.push_back( idx + 1 );
         // West
-        if ( p[0] > x_min )
-            neighbours.push_back( point_xy_t { p[0]-delta_x, p[1]         } );
+        if ( west )
+            neighbours.push_back( idx - 1 );
 
         #ifdef HEIGHT_CONNEXITY
         // North-East
-        if ( p[0] < x_max-1 &&  p[1] > y_min )
-            neighbours.push_back( point_xy_t { p[0]+delta_x, p[1]-delta_y } );
+        if ( east && north )
+            neighbours.push_back( idx - width + 1 );
         // Nopth-West
-        if ( p[0] > x_min   &&  p[1] > y_min )
-            neighbours.push_back( point_xy_t { p[0]-delta_x, p[1]-delta_y } );
+        if ( west && north )
+            neighbours.push_back( idx - width - 1 );
         // South-West
-        if ( p[0] > x_min   &&  p[1] < y_max-1 )
-            neighbours.push_back( point_xy_t { p[0]-delta_x, p[1]+delta_y } );
+        if ( west && south )
+            neighbours.push_back( idx + width - 1 );
         // South-East
-        if ( p[0] < x_max-1 &&  p[1] < y_max-1 )
-            neighbours.push_back( point_xy_t { p[0]+delta_x, p[1]+delta_y } );
+        if ( east && south )
+            neighbours.push_back( idx + width + 1 );
         #endif
-
-        return neighbours ;
     }
 
     void frontier_detector::compute_frontiers(const points_t &r_pos, double yaw,
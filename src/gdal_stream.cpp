@@ -0,0 +1,126 @@
+/*
+ * gdal_stream.cpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#include <future>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+
+#include <gdal_priv.h>
+#include <ogr_spatialref.h>
+
+#include "gladys/gdal_stream.hpp"
+
+namespace gladys {
+
+/** minimum rows per block, for strips of one row */
+static const size_t min_block_rows = 64;
+
+gdal_stream::gdal_stream(const std::string& filepath, size_t rows) {
+    GDALAllRegister();
+    dataset = (GDALDataset *) GDALOpen( filepath.c_str(), GA_ReadOnly );
+    if (dataset == NULL)
+        throw std::runtime_error("[gdal_stream] cannot open " + filepath);
+
+    width  = dataset->GetRasterXSize();
+    height = dataset->GetRasterYSize();
+    names.resize(dataset->GetRasterCount());
+    for (size_t band_id = 0; band_id < names.size(); band_id++)
+        names[band_id] = dataset->GetRasterBand(band_id + 1)->GetDescription();
+
+    block_rows = rows;
+    if (block_rows == 0 and not names.empty()) {
+        int block_x, block_y;
+        dataset->GetRasterBand(1)->GetBlockSize(&block_x, &block_y);
+        block_rows = std::max<size_t>(block_y, 1);
+        // a whole number of file blocks, at least min_block_rows
+        block_rows *= (min_block_rows + block_rows - 1) / block_rows;
+    }
+    block_rows = std::max<size_t>(1, std::min(block_rows, height));
+}
+
+gdal_stream::~gdal_stream() {
+    GDALClose( (GDALDatasetH) dataset );
+}
+
+size_t gdal_stream::get_band_id(const std::string& name) const {
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it == names.end())
+        throw std::runtime_error("[gdal_stream] no band named " + name);
+    return it - names.begin();
+}
+
+void gdal_stream::copy_meta(gdalwrap::gdal& dst, size_t n) const {
+    double transform[6];
+    dataset->GetGeoTransform( transform );
+    dst.set_size(n, width, height);
+    dst.set_transform(transform[0], transform[3], transform[1], transform[5]);
+
+    OGRSpatialReference spatial_reference( dataset->GetProjectionRef() );
+    int north = 1;
+    int zone = spatial_reference.GetUTMZone( &north );
+    dst.set_utm(zone, north);
+
+    const char* x_origin = dataset->GetMetadataItem("CUSTOM_X_ORIGIN");
+    const char* y_origin = dataset->GetMetadataItem("CUSTOM_Y_ORIGIN");
+    if (x_origin != NULL and y_origin != NULL)
+        dst.set_custom_origin(std::atof(x_origin), std::atof(y_origin));
+}
+
+void gdal_stream::read(const std::vector<size_t>& band_ids, size_t row_begin,
+        size_t row_end, std::vector<gdalwrap::raster>& buffers) const {
+    size_t rows = row_end - row_begin;
+    buffers.resize(band_ids.size());
+    for (size_t i = 0; i < band_ids.size(); i++) {
+        buffers[i].resize(width * rows);
+        CPLErr err = dataset->GetRasterBand(band_ids[i] + 1)->RasterIO(
+            GF_Read, 0, row_begin, width, rows, buffers[i].data(),
+            width, rows, GDT_Float32, 0, 0 );
+        if (err != CE_None)
+            throw std::runtime_error("[gdal_stream] cannot read band " +
+                                     names[band_ids[i]]);
+    }
+}
+
+void gdal_stream::for_each_block(const std::vector<size_t>& band_ids,
+        block_fn fn) const {
+    for (size_t band_id : band_ids)
+        if (band_id >= names.size())
+            throw std::out_of_range("[gdal_stream] band index out of range");
+
+    if (height == 0)
+        return;
+    // double buffering: read block k+1 while processing block k
+    std::vector<gdalwrap::raster> current, next;
+    std::vector<const float*> bands(band_ids.size());
+    read(band_ids, 0, block_rows, current);
+    for (size_t row_begin = 0; row_begin < height; row_begin += block_rows) {
+        size_t row_end = std::min(row_begin + block_rows, height);
+        size_t next_end = std::min(row_end + block_rows, height);
+        std::future<void> reading;
+        if (row_end < height)
+            reading = std::async(std::launch::async, [&]() {
+                read(band_ids, row_end, next_end, next);
+            });
+        for (size_t i = 0; i < band_ids.size(); i++)
+            bands[i] = current[i].data();
+        try {
+            fn(row_begin, row_end, bands);
+        } catch (...) {
+            if (reading.valid())
+                reading.wait();
+            throw;
+        }
+        if (reading.valid())
+            reading.get(); // rethrow read errors
+        std::swap(current, next);
+    }
+}
+
+} // namespace gladys
@@ -10,11 +10,52 @@
 
 #include <vector>
 #include <string>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <atomic>
+#include <algorithm>
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/connected_components.hpp>
 
 #include "gladys/gladys.hpp"
+#include "gladys/parallel.hpp"
 
 namespace gladys {
 
+namespace {
+
+typedef std::pair<long, long> grid_cell_t;
+typedef std::map<grid_cell_t, std::vector<size_t>> grid_t;
+
+/** cell of a point on a grid of 'size' meters */
+grid_cell_t grid_cell(const point_xy_t& p, double size) {
+    return grid_cell_t(std::floor(p[0] / size), std::floor(p[1] / size));
+}
+
+/** indices of the points, bucketed on a grid of 'size' meters */
+grid_t make_grid(const points_t& points, double size) {
+    grid_t grid;
+    for (size_t i = 0; i < points.size(); i++)
+        grid[grid_cell(points[i], size)].push_back(i);
+    return grid;
+}
+
+/** call fn(j) for the points j of the 3x3 grid cells around cell c */
+template <class F>
+void for_neighbours(const grid_t& grid, const grid_cell_t& c, F fn) {
+    for (long dx = -1; dx <= 1; dx++)
+    for (long dy = -1; dy <= 1; dy++) {
+        auto it = grid.find(grid_cell_t(c.first + dx, c.second + dy));
+        if (it != grid.end())
+            for (size_t j : it->second)
+                fn(j);
+    }
+}
+
+} // namespace
+
 /* state */
 
 state_t gladys::get_current_state() const {
@@ -81,9 +122,11 @@ bool gladys::is_visible(const point_xyz_t& locSensor, const point_xyz_t& locTarg
 
 points_probs_t gladys::can_see(const point_xy_t& locA, const points_t& llocB) const
 {
-    points_probs_t pbs(llocB.size());
-    for (point_xy_t locB : llocB)
-        pbs.push_back({locB, is_visible(locA, locB) ? 1.0 : 0.0});
+    points_probs_t pbs;
+    pbs.reserve(llocB.size());
+    std::vector<bool> visible = visibility.is_sensor_visible(locA, llocB);
+    for (size_t i = 0; i < llocB.size(); i++)
+        pbs.push_back({llocB[i], visible[i] ? 1.0 : 0.0});
     return pbs;
 }
 
@@ -91,21 +134,53 @@ points_t gladys::is_visible_from(const point_xy_t& locA, const points_t& llocB,
     float qmin) const
 {
     points_t points;
-    for (point_xy_t locB : llocB)
-        if (is_visible(locA, locB))
-            points.push_back(locB);
+    std::vector<bool> visible = visibility.is_sensor_visible(locA, llocB);
+    for (size_t i = 0; i < llocB.size(); i++)
+        if (visible[i])
+            points.push_back(llocB[i]);
     return points;
 }
 
 bool gladys::test_visibility_link(const points_t& llocA, const points_t& llocB,
     float qmin) const
 {
-    for (const point_xy_t& locA : llocA)
-        for (const point_xy_t& locB : llocB)
-            if (is_visible(locA, locB))
-                return true;
-    return false;
+    const robot_model& robot = visibility.get_robot();
+    const point_xyzt_t& pose = robot.get_sensor_pose();
+    // quality of a link: 1 - d / range, d from the sensor to the target
+    const double max_d = robot.get_sensor_range() * (1 - std::max(qmin, 0.f));
+    // pairs further apart are not in range (sensor offset included)
+    const double reach = max_d + std::hypot(pose[0], pose[1]);
+    if (!(reach > 0))
+        return false;
+
+    // pairs in reach, nearest first
+    grid_t grid = make_grid(llocB, reach);
+    std::vector<std::pair<double, std::pair<size_t, size_t>>> pairs;
+    for (size_t i = 0; i < llocA.size(); i++)
+        for_neighbours(grid, grid_cell(llocA[i], reach), [&](size_t j) {
+            double d = distance(llocA[i], llocB[j]);
+            if (d <= reach)
+                pairs.push_back(std::make_pair(d, std::make_pair(i, j)));
+        });
+    std::sort(pairs.begin(), pairs.end());
+
+    // threads take the next pair in turn, and stop once a link is found
+    std::atomic<size_t> next(0);
+    std::atomic<bool> found(false);
+    size_t n_threads = std::min(get_num_threads(), pairs.size());
+    parallel_for(0, n_threads, [&](size_t, size_t) {
+        for (size_t k; !found and (k = next++) < pairs.size(); ) {
+            const point_xy_t& a = llocA[ pairs[k].second.first ];
+            const point_xy_t& b = llocB[ pairs[k].second.second ];
+            point_xyz_t s = {a[0] + pose[0], a[1] + pose[1], pose[2]};
+            point_xyz_t t = {b[0], b[1], 0};
+            if (distance(s, t) <= max_d and is_visible(a, b))
+                found = true;
+        }
+    });
+    return found;
 }
+
 double gladys::look_at(int sensor, const points_t& observe) const {
     // TODO
     return 1.0;
@@ -115,7 +190,7 @@ double gladys::look_at(int sensor, const points_t& observe) const {
 
 bool gladys::can_communicate(const point_xy_t& locA, const point_xy_t& locB) const
 {
-    return visibility.is_antenna_visible(locA, locB);
+    return visibility.is_antenna_visible_approx(locA, locB, horizons_conservative);
 }
 
 bool gladys::can_communicate(const point_xyz_t& locA, const point_xyz_t& locB) const
@@ -123,4 +198,62 @@ bool gladys::can_communicate(const point_xyz_t& locA, const point_xyz_t& locB) c
     return visibility.is_antenna_visible(locA, locB);
 }
 
+bool gladys::can_communicate_cell(const point_xy_t& locA, const point_xy_t& locB) const
+{
+    return visibility.is_antenna_link_cell(visibility.pixel(locA),
+                                           visibility.pixel(locB));
+}
+
+comm_links_t gladys::communication_links(const points_t& locs) const
+{
+    const robot_model& robot = visibility.get_robot();
+    const point_xyzt_t& pose = robot.get_antenna_pose();
+    // pairs further apart can not be in range (antenna offset included)
+    double reach = robot.get_antenna_range() + std::hypot(pose[0], pose[1]);
+
+    comm_links_t result;
+    result.size = locs.size();
+    result.links.assign(locs.size() * locs.size(), false);
+    result.component.resize(locs.size());
+    if (!(reach > 0)) { // nothing in range, each point on its own
+        for (size_t i = 0; i < locs.size(); i++)
+            result.component[i] = i;
+        result.n_components = locs.size();
+        return result;
+    }
+
+    // bucket the points on a grid of the reach, pair the neighbouring cells
+    grid_t grid = make_grid(locs, reach);
+    std::vector<std::pair<size_t, size_t>> pairs;
+    for (size_t i = 0; i < locs.size(); i++)
+        for_neighbours(grid, grid_cell(locs[i], reach), [&](size_t j) {
+            if (i < j and distance(locs[i], locs[j]) <= reach)
+                pairs.push_back(std::make_pair(i, j));
+        });
+
+    // once per pair, tested both ways together (can_communicate, the
+    // antenna being at the first point)
+    std::vector<char> linked(pairs.size());
+    parallel_for(0, pairs.size(), [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++)
+            linked[k] = visibility.is_antenna_link_approx(
+                locs[ pairs[k].first ], locs[ pairs[k].second ],
+                horizons_conservative);
+    }, 16);
+
+    boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS>
+        graph(locs.size());
+    for (size_t k = 0; k < pairs.size(); k++) {
+        if (!linked[k])
+            continue;
+        size_t i = pairs[k].first, j = pairs[k].second;
+        result.links[i * locs.size() + j] = true;
+        result.links[j * locs.size() + i] = true;
+        boost::add_edge(i, j, graph);
+    }
+    result.n_components = locs.empty() ? 0 :
+        boost::connected_components(graph, &result.component[0]);
+    return result;
+}
+
 } // namespace gladys
@@ -0,0 +1,123 @@
+/*
+ * horizon_map.cpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "gladys/horizon_map.hpp"
+
+namespace gladys {
+
+std::vector<horizon_map::neighbour> horizon_map::_prepare(
+        const pixel_transform& pixels, double _sensor_z, double _range,
+        size_t _sectors, size_t _rings, bool with_lower) {
+    width    = pixels.get_width();
+    height   = pixels.get_height();
+    sectors  = _sectors;
+    rings    = _rings;
+    scale_x  = std::abs(pixels.get_scale_x());
+    scale_y  = std::abs(pixels.get_scale_y());
+    sensor_z = _sensor_z;
+    range    = _range;
+    if (sectors == 0 or rings == 0)
+        throw std::invalid_argument("[horizon_map] no sector or ring");
+
+    const double r = half_diagonal(), reach = this->reach();
+    const double inf = std::numeric_limits<double>::infinity();
+
+    std::vector<neighbour> stencil;
+    long rx = std::ceil(reach / scale_x), ry = std::ceil(reach / scale_y);
+    for (long dy = -ry; dy <= ry; dy++)
+    for (long dx = -rx; dx <= rx; dx++) {
+        double d = distance(dx, dy);
+        if (d > reach)
+            continue;
+        neighbour n = {dx, dy, d, ring_at(d), long(sector(dx, dy)), 0, sectors};
+        if (d > r) {
+            double angle = std::atan2(dy * scale_y, dx * scale_x);
+            double delta = std::asin(r / d) + 1e-9;
+            n.k0 = std::floor(sector_at(angle - delta));
+            long k1 = std::floor(sector_at(angle + delta));
+            n.count = std::min(size_t(k1 - n.k0 + 1), sectors);
+        }
+        stencil.push_back(n);
+    }
+
+    const size_t size = rings * sectors;
+    std::vector<float>(width * height * size, inf).swap(upper);
+    std::vector<float>(with_lower ? width * height * size : 0, inf).swap(lower);
+    return stencil;
+}
+
+gdalwrap::gdal horizon_map::to_gdal(const gdalwrap::gdal& dtm) const {
+    const size_t size = rings * sectors;
+    gdalwrap::gdal map;
+    map.copy_meta(dtm, has_lower() ? 2 * size : size);
+    for (size_t j = 0; j < rings; j++)
+    for (size_t k = 0; k < sectors; k++) {
+        size_t band = j * sectors + k;
+        std::string suffix = std::to_string(j) + "_" + std::to_string(k);
+        map.names[band] = "HORIZON_UP_" + suffix;
+        for (size_t idx = 0; idx < width * height; idx++)
+            map.bands[band][idx] = upper[idx * size + band];
+        if (not has_lower())
+            continue;
+        map.names[size + band] = "HORIZON_LOW_" + suffix;
+        for (size_t idx = 0; idx < width * height; idx++)
+            map.bands[size + band][idx] = lower[idx * size + band];
+    }
+    map.metadata["HORIZON_SENSOR_Z"] = std::to_string(sensor_z);
+    map.metadata["HORIZON_RANGE"] = std::to_string(range);
+    return map;
+}
+
+void horizon_map::from_gdal(const gdalwrap::gdal& map,
+        double _sensor_z, double _range) {
+    // the upper bands, then the lower ones if any
+    const size_t size = std::count_if(map.names.begin(), map.names.end(),
+        [](const std::string& name) { return name.compare(0, 11, "HORIZON_UP_") == 0; });
+    const bool with_lower = map.bands.size() == 2 * size;
+    if (size == 0 or map.names[0] != "HORIZON_UP_0_0" or
+        (with_lower and map.names[size] != "HORIZON_LOW_0_0") or
+        (not with_lower and map.bands.size() != size))
+        throw std::runtime_error("[horizon_map] not a horizon map");
+    // the meta-data are not kept by every format
+    for (auto& kv : {std::make_pair("HORIZON_SENSOR_Z", _sensor_z),
+                     std::make_pair("HORIZON_RANGE", _range)}) {
+        auto it = map.metadata.find(kv.first);
+        if (it != map.metadata.end() and
+            std::abs(std::stod(it->second) - kv.second) > 1e-5)
+            throw std::runtime_error("[horizon_map] built for another sensor");
+    }
+    sensor_z = _sensor_z;
+    range    = _range;
+    // bands of the first ring, then of the next ones
+    for (sectors = 1; sectors < size and map.names[sectors] != "HORIZON_UP_1_0"; )
+        sectors++;
+    rings   = size / sectors;
+    width   = map.get_width();
+    height  = map.get_height();
+    scale_x = std::abs(map.get_scale_x());
+    scale_y = std::abs(map.get_scale_y());
+    std::vector<float>(width * height * size).swap(upper);
+    std::vector<float>(with_lower ? width * height * size : 0).swap(lower);
+    for (size_t band = 0; band < size; band++)
+        for (size_t idx = 0; idx < width * height; idx++) {
+            upper[idx * size + band] = map.bands[band][idx];
+            if (with_lower)
+                lower[idx * size + band] = map.bands[size + band][idx];
+        }
+}
+
+} // namespace gladys
@@ -0,0 +1,112 @@
+/*
+ * los_kernel.cpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#include <cmath>
+#include <string>
+
+#include "gladys/los_kernel.hpp"
+
+// x86 kernels, built with function target attributes and picked at run
+// time, whatever the flags the library is compiled with
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GLADYS_LOS_X86
+#include <immintrin.h>
+#endif
+
+namespace gladys {
+
+namespace {
+
+bool los_scalar(const los_batch& batch, double zs, double a,
+                double n_min, double eps) {
+    for (size_t i = 0; i < batch.count; i++) {
+        if ( batch.n[i] < n_min )
+            continue;
+        double d = std::sqrt( batch.dx[i] * batch.dx[i] + batch.dy[i] * batch.dy[i] );
+        if ( a * d + batch.z[i] - zs > eps )
+            return true;
+    }
+    return false;
+}
+
+#ifdef GLADYS_LOS_X86
+__attribute__((target("sse2")))
+bool los_sse2(const los_batch& batch, double zs, double a,
+              double n_min, double eps) {
+    const __m128d v_a = _mm_set1_pd(a), v_zs = _mm_set1_pd(zs),
+                  v_n_min = _mm_set1_pd(n_min), v_eps = _mm_set1_pd(eps);
+    __m128d hit = _mm_setzero_pd();
+    for (size_t i = 0; i < batch.count; i += 2) {
+        __m128d dx = _mm_loadu_pd(batch.dx + i), dy = _mm_loadu_pd(batch.dy + i);
+        __m128d d = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+        __m128d z = _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double*) (batch.z + i))));
+        __m128d np = _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double*) (batch.n + i))));
+        __m128d h = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(v_a, d), z), v_zs);
+        if (i + 1 == batch.count) // lane past count, not above
+            h = _mm_unpacklo_pd(h, v_eps);
+        // known (not n < n_min) and above the line
+        hit = _mm_or_pd(hit, _mm_andnot_pd(_mm_cmplt_pd(np, v_n_min),
+                                           _mm_cmpgt_pd(h, v_eps)));
+    }
+    return _mm_movemask_pd(hit) != 0;
+}
+
+// no "fma" target: a*d + z must stay two rounded operations
+__attribute__((target("avx2")))
+bool los_avx2(const los_batch& batch, double zs, double a,
+              double n_min, double eps) {
+    const __m256d v_a = _mm256_set1_pd(a), v_zs = _mm256_set1_pd(zs),
+                  v_n_min = _mm256_set1_pd(n_min), v_eps = _mm256_set1_pd(eps);
+    const __m256d lanes = _mm256_set_pd(3, 2, 1, 0);
+    __m256d hit = _mm256_setzero_pd();
+    for (size_t i = 0; i < batch.count; i += 4) {
+        __m256d dx = _mm256_loadu_pd(batch.dx + i), dy = _mm256_loadu_pd(batch.dy + i);
+        __m256d d = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx),
+                                                 _mm256_mul_pd(dy, dy)));
+        __m256d z = _mm256_cvtps_pd(_mm_loadu_ps(batch.z + i));
+        __m256d np = _mm256_cvtps_pd(_mm_loadu_ps(batch.n + i));
+        __m256d h = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(v_a, d), z), v_zs);
+        // lanes past count
+        __m256d valid = _mm256_cmp_pd(lanes, _mm256_set1_pd(double(batch.count - i)),
+                                      _CMP_LT_OQ);
+        hit = _mm256_or_pd(hit, _mm256_and_pd(valid, _mm256_andnot_pd(
+            _mm256_cmp_pd(np, v_n_min, _CMP_LT_OQ),
+            _mm256_cmp_pd(h, v_eps, _CMP_GT_OQ))));
+    }
+    return _mm256_movemask_pd(hit) != 0;
+}
+#endif
+
+} // namespace
+
+los_kernel_t get_los_kernel(const std::string& name) {
+    if (name == "scalar")
+        return los_scalar;
+#ifdef GLADYS_LOS_X86
+    __builtin_cpu_init();
+    if (name == "sse2" and __builtin_cpu_supports("sse2"))
+        return los_sse2;
+    if (name == "avx2" and __builtin_cpu_supports("avx2"))
+        return los_avx2;
+#endif
+    return NULL;
+}
+
+const std::string& get_los_kernel_name() {
+    static const std::string name = get_los_kernel("avx2") ? "avx2" :
+                                    get_los_kernel("sse2") ? "sse2" : "scalar";
+    return name;
+}
+
+los_kernel_t get_los_kernel() {
+    static const los_kernel_t kernel = get_los_kernel(get_los_kernel_name());
+    return kernel;
+}
+
+} // namespace gladys
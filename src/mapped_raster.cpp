@@ -0,0 +1,185 @@
+/*
+ * mapped_raster.cpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gladys/mapped_raster.hpp"
+
+namespace gladys {
+
+static const char magic[8] = {'G','L','D','S','T','I','L','E'};
+static const uint32_t format_version = 2;
+static const size_t page_size = 4096; // band data alignment
+
+/*
+ * file layout (native byte order):
+ *   magic, uint32 version, uint32 shift,
+ *   uint64 width, height, band count,
+ *   double utm x, utm y, scale x, scale y, custom x origin, custom y origin,
+ *   int32 utm zone, uint32 utm north (1 or 0),
+ *   for each band: uint64 name length, name, then
+ *   zero padding up to a page, and the bands tiles, each band page aligned.
+ */
+struct header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t shift;
+    uint64_t width, height, n_bands;
+    double geo[6];
+    int32_t utm_zone;
+    uint32_t utm_north;
+};
+
+static size_t align(size_t offset) {
+    return (offset + page_size - 1) / page_size * page_size;
+}
+
+static size_t band_length(size_t width, size_t height, size_t shift) {
+    size_t side = size_t(1) << shift;
+    size_t tiles_x = (width  + side - 1) >> shift;
+    size_t tiles_y = (height + side - 1) >> shift;
+    return align(tiles_x * tiles_y * side * side * sizeof(float));
+}
+
+void mapped_raster::save(const gdalwrap::gdal& src,
+        const std::vector<std::string>& band_names,
+        const std::string& filepath, size_t shift) {
+    std::ofstream out(filepath, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("[mapped_raster] cannot open " + filepath);
+
+    header_t header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = format_version;
+    header.shift = shift;
+    header.width = src.get_width();
+    header.height = src.get_height();
+    header.n_bands = band_names.size();
+    header.geo[0] = src.get_utm_pose_x();
+    header.geo[1] = src.get_utm_pose_y();
+    header.geo[2] = src.get_scale_x();
+    header.geo[3] = src.get_scale_y();
+    header.geo[4] = src.get_custom_x_origin();
+    header.geo[5] = src.get_custom_y_origin();
+    header.utm_zone = src.get_utm_zone();
+    header.utm_north = src.is_utm_north();
+    out.write((const char*) &header, sizeof(header));
+    size_t offset = sizeof(header);
+    for (const auto& name : band_names) {
+        uint64_t size = name.size();
+        out.write((const char*) &size, sizeof(size));
+        out.write(name.data(), size);
+        offset += sizeof(size) + size;
+    }
+
+    size_t side = size_t(1) << shift;
+    size_t tiles_x = (header.width  + side - 1) >> shift;
+    size_t tiles_y = (header.height + side - 1) >> shift;
+    std::vector<float> tile(side * side);
+    for (const auto& name : band_names) {
+        const gdalwrap::raster& band = src.get_band(name);
+        std::vector<char> padding(align(offset) - offset, 0);
+        out.write(padding.data(), padding.size());
+        offset = align(offset);
+        for (size_t ty = 0; ty < tiles_y; ty++)
+        for (size_t tx = 0; tx < tiles_x; tx++) {
+            std::fill(tile.begin(), tile.end(),
+                      std::numeric_limits<float>::quiet_NaN());
+            for (size_t y = ty * side; y < std::min((ty + 1) * side, size_t(header.height)); y++)
+            for (size_t x = tx * side; x < std::min((tx + 1) * side, size_t(header.width)); x++)
+                tile[(y - ty * side) * side + (x - tx * side)] =
+                    band[x + y * header.width];
+            out.write((const char*) tile.data(), tile.size() * sizeof(float));
+            offset += tile.size() * sizeof(float);
+        }
+    }
+    std::vector<char> padding(align(offset) - offset, 0);
+    out.write(padding.data(), padding.size());
+    if (!out)
+        throw std::runtime_error("[mapped_raster] cannot write " + filepath);
+}
+
+mapped_raster::mapped_raster(const std::string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("[mapped_raster] cannot open " + filepath);
+    struct stat st;
+    if (fstat(fd, &st) < 0 or size_t(st.st_size) < sizeof(header_t)) {
+        close(fd);
+        throw std::runtime_error("[mapped_raster] not a tiled raster " + filepath);
+    }
+    length = st.st_size;
+    addr = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file
+    if (addr == MAP_FAILED)
+        throw std::runtime_error("[mapped_raster] cannot map " + filepath);
+
+    try {
+        const char* base = (const char*) addr;
+        header_t header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 or
+            header.version != format_version or header.shift > 16)
+            throw std::runtime_error("[mapped_raster] not a tiled raster " + filepath);
+
+        size_t offset = sizeof(header);
+        for (size_t i = 0; i < header.n_bands; i++) {
+            uint64_t size;
+            if (offset + sizeof(size) > length)
+                throw std::runtime_error("[mapped_raster] truncated " + filepath);
+            std::memcpy(&size, base + offset, sizeof(size));
+            offset += sizeof(size);
+            if (offset + size > length)
+                throw std::runtime_error("[mapped_raster] truncated " + filepath);
+            names.push_back(std::string(base + offset, size));
+            offset += size;
+        }
+        offset = align(offset);
+        size_t band_size = band_length(header.width, header.height, header.shift);
+        if (offset + header.n_bands * band_size > length)
+            throw std::runtime_error("[mapped_raster] truncated " + filepath);
+        for (size_t i = 0; i < header.n_bands; i++) {
+            bands.push_back(tiled_raster((const float*) (base + offset),
+                header.width, header.height, header.shift));
+            offset += band_size;
+        }
+
+        meta.set_size(0, header.width, header.height);
+        meta.set_transform(header.geo[0], header.geo[1],
+                           header.geo[2], header.geo[3]);
+        meta.set_custom_origin(header.geo[4], header.geo[5]);
+        meta.set_utm(header.utm_zone, header.utm_north != 0);
+    } catch (...) {
+        munmap(addr, length);
+        throw;
+    }
+}
+
+mapped_raster::~mapped_raster() {
+    munmap(addr, length);
+}
+
+const tiled_raster& mapped_raster::get_band(const std::string& name) const {
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it == names.end())
+        throw std::runtime_error("[mapped_raster] no band named " + name);
+    return bands[it - names.begin()];
+}
+
+} // namespace gladys
@@ -11,20 +11,126 @@
 #include <cmath>
 #include <ctime>
 #include <limits>
+#include <memory>
+#include <algorithm>
+#include <functional>
 
 #include <boost/graph/graphviz.hpp>
+#include <boost/graph/astar_search.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 
 #include "gladys/nav_graph.hpp"
 
 namespace gladys {
 
+namespace {
+
+/* property map of a vector growing with the graph: the vertices added
+ * during a (lazy) search read as the initial value */
+template <class T>
+class growing_map {
+    std::shared_ptr< std::vector<T> > values;
+    T init;
+public:
+    typedef vertex_t key_type;
+    typedef T value_type;
+    typedef T reference;
+    typedef boost::read_write_property_map_tag category;
+
+    growing_map(size_t size, const T& _init) :
+        values(std::make_shared< std::vector<T> >(size, _init)), init(_init) {}
+
+    T get(vertex_t v) const {
+        return v < values->size() ? (*values)[v] : init;
+    }
+    void put(vertex_t v, const T& x) const {
+        if (v >= values->size())
+            values->resize(v + 1, init);
+        (*values)[v] = x;
+    }
+};
+
+template <class T>
+T get(const growing_map<T>& m, vertex_t v) {
+    return m.get(v);
+}
+template <class T>
+void put(const growing_map<T>& m, vertex_t v,
+         const typename growing_map<T>::value_type& x) {
+    m.put(v, x);
+}
+
+// the closest vertex, once the pending cells around p are built
+inline vertex_t closest_vertex(nav_graph& ng, const point_xy_t& p) {
+    ng.expand_around(p);
+    return ng.get_closest_vertex(p);
+}
+
+// build the lazy cells of a vertex before its out-edges get iterated
+template <class Visitor>
+class lazy_edges_visitor : public Visitor {
+    nav_graph& ng;
+public:
+    lazy_edges_visitor(const Visitor& vis, nav_graph& _ng)
+        : Visitor(vis), ng(_ng) {}
+
+    void examine_vertex(vertex_t u, const graph_t& g) {
+        Visitor::examine_vertex(u, g);
+        ng.expand_vertex(u);
+    }
+};
+
+const double inf = std::numeric_limits<double>::infinity();
+
+/* A* from s, the goal visitor throws found_goal. As boost::astar_search,
+ * but its maps grow with the graph for the search to build cells on the
+ * way; distances are summed in double (float for boost::astar_search,
+ * the type of the edge weights) */
+template <class Heuristic, class Visitor>
+void lazy_astar(nav_graph& ng, vertex_t s, Heuristic h, const Visitor& vis,
+                growing_map<vertex_t>& predecessors, growing_map<double>& distances) {
+    const graph_t& g = ng.get_partial_graph();
+    size_t n = boost::num_vertices(g);
+    growing_map<double> ranks(n, inf);
+    growing_map<boost::default_color_type> colors(n, boost::white_color);
+    put(predecessors, s, s);
+    put(distances, s, 0.0);
+    put(ranks, s, h(s));
+    boost::astar_search_no_init(g, s, h,
+        lazy_edges_visitor<Visitor>(vis, ng),
+        predecessors, ranks, distances, boost::get(&edge::weight, g), colors,
+        boost::get(boost::vertex_index, g), std::less<double>(),
+        boost::closed_plus<double>(inf), inf, 0.0);
+}
+
+} // namespace
+
+void nav_graph::add_cell_edges(vertex_t vert_w, vertex_t vert_n,
+        vertex_t vert_e, vertex_t vert_s, float weight, time_t t) {
+    // most of the time this is equal to sqrt(2)/2
+    float hypotenuse = 0.5 * std::sqrt( scale_x*scale_x + scale_y*scale_y );
+
+    // create edges and set weight
+    // length = .5 * math.sqrt( scale_x**2 + scale_y**2 )
+    edge e;
+    e.t = t;
+    e.weight = hypotenuse * weight;
+    boost::add_edge(vert_w, vert_n, e, g);
+    boost::add_edge(vert_n, vert_e, e, g);
+    boost::add_edge(vert_e, vert_s, e, g);
+    boost::add_edge(vert_s, vert_w, e, g);
+    // also add straight connexions
+    e.weight = std::abs(scale_y) * weight;
+    boost::add_edge(vert_n, vert_s, e, g); // length = scale_y
+    e.weight = std::abs(scale_x) * weight;
+    boost::add_edge(vert_w, vert_e, e, g); // length = scale_x
+}
+
 void nav_graph::_load() {
     float weight;
     vertex_t vert_w, vert_n, vert_e, vert_s;
-    const gdalwrap::raster& weight_map = map.get_weight_band();
-    // most of the time this is equal to sqrt(2)/2
-    float hypotenuse = 0.5 * std::sqrt( scale_x*scale_x + scale_y*scale_y );
+    if (lazy_unknown)
+        pending.assign(width * height, false);
 
     // XXX wrong, it must come from the under layer
     time_t t = std::time(0);
@@ -37,12 +143,13 @@ void nav_graph::_load() {
         // weight is a float in seconds per meter
         // or > if obstacle (+inf)
         // or < if unknown
-        weight = weight_map[px_x + px_y * width];
+        weight = map.get_weight(px_x, px_y);
 
-        // if unknown, then weight is max (100)
-        // in order to allow exploration plan in unknown areas.
-        if (weight <= 0)
-            weight = 100.0;
+        if ( lazy_unknown and weight <= 0 ) { // UNKNOWN, see expand_cell
+            pending[px_x + px_y * width] = true;
+            n_pending++;
+            continue;
+        }
 
         vert_w = get_vertex_or_create(utm_x + scale_x * (px_x - 0.5), utm_y + scale_y * (px_y      ));
         vert_n = get_vertex_or_create(utm_x + scale_x * (px_x      ), utm_y + scale_y * (px_y - 0.5));
@@ -53,24 +160,75 @@ void nav_graph::_load() {
         if ( weight == std::numeric_limits<float>::infinity() ) // OBSTACLE
             continue;
 
-        // create edges and set weight
-        // length = .5 * math.sqrt( scale_x**2 + scale_y**2 )
-        edge e;
-        e.t = t;
-        e.weight = hypotenuse * weight;
-        boost::add_edge(vert_w, vert_n, e, g);
-        boost::add_edge(vert_n, vert_e, e, g);
-        boost::add_edge(vert_e, vert_s, e, g);
-        boost::add_edge(vert_s, vert_w, e, g);
-        // also add straight connexions
-        e.weight = std::abs(scale_y) * weight;
-        boost::add_edge(vert_n, vert_s, e, g); // length = scale_y
-        e.weight = std::abs(scale_x) * weight;
-        boost::add_edge(vert_w, vert_e, e, g); // length = scale_x
+        if ( weight <= 0 ) // UNKNOWN
+            // if unknown, then weight is max (100)
+            // in order to allow exploration plan in unknown areas.
+            weight = 100.0;
+
+        add_cell_edges(vert_w, vert_n, vert_e, vert_s, weight, t);
+    }
+}
+
+void nav_graph::expand_cell(size_t px_x, size_t px_y) {
+    if (px_x >= width or px_y >= height or !pending[px_x + px_y * width])
+        return;
+    pending[px_x + px_y * width] = false;
+    n_pending--;
+
+    double utm_x = map.get_utm_pose_x(),
+           utm_y = map.get_utm_pose_y();
+    // the sides shared with built cells already have their vertex
+    vertex_t vert_w = get_vertex_or_create(utm_x + scale_x * (px_x - 0.5), utm_y + scale_y * (px_y      )),
+             vert_n = get_vertex_or_create(utm_x + scale_x * (px_x      ), utm_y + scale_y * (px_y - 0.5)),
+             vert_e = get_vertex_or_create(utm_x + scale_x * (px_x + 0.5), utm_y + scale_y * (px_y      )),
+             vert_s = get_vertex_or_create(utm_x + scale_x * (px_x      ), utm_y + scale_y * (px_y + 0.5));
+    // unknown cell, same weight as in _load
+    add_cell_edges(vert_w, vert_n, vert_e, vert_s, 100.0, std::time(0));
+}
+
+void nav_graph::expand_vertex(const vertex_t& v) {
+    if (n_pending == 0)
+        return;
+    // vertices lie in the middle of the cell sides: find the two cells
+    // sharing v from its position in half pixels
+    const point_xy_t& p = g[v].pt;
+    long hx = std::lround(2 * (p[0] - map.get_utm_pose_x()) / scale_x);
+    long hy = std::lround(2 * (p[1] - map.get_utm_pose_y()) / scale_y);
+    if (hx % 2 != 0 and hy >= 0) { // west or east side
+        if (hx >= 1)
+            expand_cell((hx - 1) / 2, hy / 2);
+        if (hx >= -1)
+            expand_cell((hx + 1) / 2, hy / 2);
+    } else if (hy % 2 != 0 and hx >= 0) { // north or south side
+        if (hy >= 1)
+            expand_cell(hx / 2, (hy - 1) / 2);
+        if (hy >= -1)
+            expand_cell(hx / 2, (hy + 1) / 2);
     }
 }
 
+void nav_graph::expand_around(const point_xy_t& p) {
+    if (n_pending == 0)
+        return;
+    // cell of p, clamped to the map
+    long px_x = std::lround((p[0] - map.get_utm_pose_x()) / scale_x);
+    long px_y = std::lround((p[1] - map.get_utm_pose_y()) / scale_y);
+    px_x = std::min(std::max(px_x, 0L), long(width)  - 1);
+    px_y = std::min(std::max(px_y, 0L), long(height) - 1);
+    for (long dx = -1; dx <= 1; dx++)
+    for (long dy = -1; dy <= 1; dy++)
+        if (px_x + dx >= 0 and px_y + dy >= 0)
+            expand_cell(px_x + dx, px_y + dy);
+}
+
+void nav_graph::expand_all() {
+    for (size_t px_x = 0; px_x < width  and n_pending > 0; px_x++)
+    for (size_t px_y = 0; px_y < height and n_pending > 0; px_y++)
+        expand_cell(px_x, px_y);
+}
+
 path_t nav_graph::astar_search(const point_xy_t& start, const point_xy_t& goal) const {
+    check_expanded();
     vertex_t goal_v = get_closest_vertex(goal);
     astar_goal_visitor vis(goal_v);
     path_t shortest_path;
@@ -100,6 +258,7 @@ path_t nav_graph::astar_search(const point_xy_t& start, const point_xy_t& goal)
 }
 
 detailed_path_t nav_graph::detailed_astar_search(const point_xy_t& start, const point_xy_t& goal) const {
+    check_expanded();
     detailed_path_t res;
 
     vertex_t goal_v = get_closest_vertex(goal);
@@ -133,6 +292,7 @@ detailed_path_t nav_graph::detailed_astar_search(const point_xy_t& start, const
 }
 
 path_cost_util_t nav_graph::astar_search(const points_t& start, const points_t& goal) const {
+    check_expanded();
     vertex_t gv;
     vertices_t goal_v;
     for (auto& p : goal)
@@ -174,7 +334,104 @@ path_cost_util_t nav_graph::astar_search(const points_t& start, const points_t&
     return res;
 }
 
+path_t nav_graph::astar_search(const point_xy_t& start, const point_xy_t& goal) {
+    if (is_expanded())
+        return static_cast<const nav_graph&>(*this).astar_search(start, goal);
+    return _lazy_astar_search(start, goal);
+}
+
+detailed_path_t nav_graph::detailed_astar_search(const point_xy_t& start, const point_xy_t& goal) {
+    if (is_expanded())
+        return static_cast<const nav_graph&>(*this).detailed_astar_search(start, goal);
+    return _lazy_detailed_astar_search(start, goal);
+}
+
+path_cost_util_t nav_graph::astar_search(const points_t& start, const points_t& goal) {
+    if (is_expanded())
+        return static_cast<const nav_graph&>(*this).astar_search(start, goal);
+    return _lazy_astar_search(start, goal);
+}
+
+path_t nav_graph::_lazy_astar_search(const point_xy_t& start, const point_xy_t& goal) {
+    vertex_t goal_v = closest_vertex(*this, goal);
+    vertex_t start_v = closest_vertex(*this, start);
+    astar_goal_visitor vis(goal_v);
+    path_t shortest_path;
+    nav_goal_heuristic heuristic(g, goal_v);
+    growing_map<vertex_t> predecessors(num_vertices(g), start_v);
+    growing_map<double> distances(boost::num_vertices(g), inf);
+    try {
+        lazy_astar(*this, start_v, heuristic, vis, predecessors, distances);
+    } catch (found_goal) {
+        for(vertex_t v = goal_v;; v = get(predecessors, v)) {
+            shortest_path.push_front(g[v].pt);
+            if (get(predecessors, v) == v)
+                break;
+        }
+    }
+    return shortest_path;
+}
+
+detailed_path_t nav_graph::_lazy_detailed_astar_search(const point_xy_t& start,
+                                                       const point_xy_t& goal) {
+    detailed_path_t res;
+
+    vertex_t goal_v = closest_vertex(*this, goal);
+    vertex_t start_v = closest_vertex(*this, start);
+    astar_goal_visitor vis(goal_v);
+    nav_goal_heuristic heuristic(g, goal_v);
+
+    growing_map<vertex_t> predecessors(num_vertices(g), start_v);
+    growing_map<double> distances(boost::num_vertices(g), inf);
+
+    try {
+        lazy_astar(*this, start_v, heuristic, vis, predecessors, distances);
+    } catch (found_goal) {
+        for(vertex_t v = goal_v;; v = get(predecessors, v)) {
+            res.path.push_front(g[v].pt);
+            res.costs.push_front( get(distances, v) );
+            if (get(predecessors, v) == v)
+                break;
+        }
+    }
+    return res;
+}
+
+path_cost_util_t nav_graph::_lazy_astar_search(const points_t& start, const points_t& goal) {
+    vertex_t gv;
+    vertices_t goal_v;
+    for (auto& p : goal)
+        goal_v.push_back( closest_vertex( *this, p ) );
+    vertex_t start_v = closest_vertex(*this, start[0]);
+
+    astar_goals_visitor vis(goal_v);
+
+    path_t shortest_path;
+    nav_goals_heuristic heuristic(g, goal_v);
+    growing_map<vertex_t> predecessors(num_vertices(g), start_v);
+    growing_map<double> distances(boost::num_vertices(g), inf);
+    try {
+        lazy_astar(*this, start_v, heuristic, vis, predecessors, distances);
+    } catch (found_goal& e) {
+        gv = e.g ;
+        for(vertex_t v = e.g;; v = get(predecessors, v)) {
+            shortest_path.push_front(g[v].pt);
+            if (get(predecessors, v) == v)
+                break;
+        }
+    }
+    path_cost_util_t res;
+    res.path = shortest_path;
+    if (res.path.size() == 0 ) // no path_found
+        res.cost = std::numeric_limits<float>::infinity();
+    else
+        res.cost = get(distances, gv);
+    return res;
+}
+
 std::vector<double> nav_graph::single_source_all_costs(const point_xy_t& start, const points_t& goals){
+    // dijkstra reaches every cell, and its maps can't grow
+    expand_all();
 
     std::vector<vertex_t> predecessors(num_vertices(g));
     std::vector<double> distances(boost::num_vertices(g));
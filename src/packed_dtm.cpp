@@ -0,0 +1,52 @@
+/*
+ * packed_dtm.cpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#include <algorithm>
+
+#include "gladys/packed_dtm.hpp"
+#include "gladys/parallel.hpp"
+
+namespace gladys {
+
+void packed_dtm::pack(const gdalwrap::raster& z_max,
+        const gdalwrap::raster& n_points, size_t _width, size_t _height,
+        bool morton) {
+    width  = _width;
+    height = _height;
+    blocks_x = 0;
+    size_t size = width * height;
+    if (morton) {
+        const size_t side = size_t(1) << block_shift;
+        blocks_x = (width + side - 1) / side;
+        size_t blocks_y = (height + side - 1) / side;
+        size = blocks_x * blocks_y * side * side;
+    }
+    // padding cells are never read
+    std::vector<dtm_cell>(size, dtm_cell{0, 0}).swap(cells);
+    update(z_max, n_points, 0, 0, width, height);
+}
+
+void packed_dtm::update(const gdalwrap::raster& z_max,
+        const gdalwrap::raster& n_points,
+        size_t x0, size_t y0, size_t x1, size_t y1) {
+    x1 = std::min(x1, width);
+    y1 = std::min(y1, height);
+    if (x0 >= x1 or y0 >= y1)
+        return;
+    parallel_for(y0, y1, [&](size_t row_begin, size_t row_end) {
+        for (size_t y = row_begin; y < row_end; y++)
+        for (size_t x = x0; x < x1; x++) {
+            dtm_cell& cell = cells[ pos(x, y) ];
+            cell.z_max    = z_max[ x + y * width ];
+            cell.n_points = n_points[ x + y * width ];
+        }
+    }, 64);
+}
+
+} // namespace gladys
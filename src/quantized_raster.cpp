@@ -0,0 +1,88 @@
+/*
+ * quantized_raster.cpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#include <set>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+#include "gladys/quantized_raster.hpp"
+
+namespace gladys {
+
+quantized_raster::quantized_raster(const gdalwrap::raster& band,
+        size_t _bits) : bits(_bits) {
+    if (bits != 8 and bits != 16)
+        throw std::invalid_argument("[quantized_raster] bits must be 8 or 16");
+    size_t n_codes = size_t(1) << bits;
+
+    std::set<float> values;
+    std::set<float> specials; // non-positive and infinite, kept exact
+    float vmin = std::numeric_limits<float>::infinity(), vmax = 0;
+    for (float value : band) {
+        if (std::isnan(value))
+            throw std::invalid_argument("[quantized_raster] NaN in band");
+        if (values.size() <= n_codes)
+            values.insert(value);
+        if (value <= 0 or std::isinf(value)) {
+            specials.insert(value);
+        } else {
+            vmin = std::min(vmin, value);
+            vmax = std::max(vmax, value);
+        }
+    }
+
+    if (bits == 8)
+        codes8.resize(band.size());
+    else
+        codes16.resize(band.size());
+    auto set_code = [&](size_t idx, size_t code) {
+        if (bits == 8)
+            codes8[idx] = code;
+        else
+            codes16[idx] = code;
+    };
+
+    lossless = values.size() <= n_codes;
+    if (lossless) {
+        table.assign(values.begin(), values.end());
+        for (size_t idx = 0; idx < band.size(); idx++)
+            set_code(idx, std::lower_bound(table.begin(), table.end(),
+                                           band[idx]) - table.begin());
+    } else {
+        if (specials.size() >= n_codes)
+            throw std::invalid_argument("[quantized_raster] too many special values");
+        table.assign(specials.begin(), specials.end());
+        size_t first = table.size(), n_bins = n_codes - first;
+        double log_min = std::log(vmin);
+        double step = (std::log(vmax) - log_min) / n_bins;
+        for (size_t bin = 0; bin < n_bins; bin++)
+            table.push_back(std::exp(log_min + (bin + 0.5) * step));
+        for (size_t idx = 0; idx < band.size(); idx++) {
+            float value = band[idx];
+            if (value <= 0 or std::isinf(value)) {
+                set_code(idx, std::lower_bound(table.begin(),
+                    table.begin() + first, value) - table.begin());
+            } else {
+                size_t bin = (std::log(value) - log_min) / step;
+                set_code(idx, first + std::min(bin, n_bins - 1));
+            }
+        }
+    }
+}
+
+gdalwrap::raster quantized_raster::decode() const {
+    gdalwrap::raster band(size());
+    for (size_t idx = 0; idx < band.size(); idx++)
+        band[idx] = (*this)[idx];
+    return band;
+}
+
+} // namespace gladys
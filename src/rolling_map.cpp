@@ -0,0 +1,192 @@
+/*
+ * rolling_map.cpp
+ *
+ * Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#include <cmath>
+#include <ctime>
+#include <limits>
+#include <stdexcept>
+
+#include "gladys/rolling_map.hpp"
+
+namespace gladys {
+
+// edges of a slot, in edges[6 * slot + i]
+enum {E_WN, E_NE, E_ES, E_SW, E_NS, E_WE, E_COUNT};
+
+rolling_map::rolling_map(const weight_map& w_map, size_t _width,
+        size_t _height, const point_xy_t& center) : map(w_map),
+        width(_width), height(_height), ring_w(_width + 1),
+        ring_h(_height + 1) {
+    if (width == 0 or height == 0)
+        throw std::invalid_argument("[rolling_map] empty window");
+    scale_x = map.get_scale_x();
+    scale_y = map.get_scale_y();
+    hypotenuse = 0.5 * std::sqrt( scale_x*scale_x + scale_y*scale_y );
+
+    // fixed topology: vertex 2*slot is the west side, 2*slot+1 the north
+    size_t n_slots = ring_w * ring_h;
+    g = graph_t(2 * n_slots);
+    edges.resize(E_COUNT * n_slots);
+    edge e;
+    e.weight = std::numeric_limits<float>::infinity();
+    e.t = 0;
+    for (size_t sy = 0; sy < ring_h; sy++)
+    for (size_t sx = 0; sx < ring_w; sx++) {
+        size_t s = sx + sy * ring_w;
+        vertex_t vert_w = 2 * s,
+                 vert_n = 2 * s + 1,
+                 vert_e = 2 * ((sx + 1) % ring_w + sy * ring_w),
+                 vert_s = 2 * (sx + (sy + 1) % ring_h * ring_w) + 1;
+        edge_t* se = &edges[E_COUNT * s];
+        se[E_WN] = boost::add_edge(vert_w, vert_n, e, g).first;
+        se[E_NE] = boost::add_edge(vert_n, vert_e, e, g).first;
+        se[E_ES] = boost::add_edge(vert_e, vert_s, e, g).first;
+        se[E_SW] = boost::add_edge(vert_s, vert_w, e, g).first;
+        se[E_NS] = boost::add_edge(vert_n, vert_s, e, g).first;
+        se[E_WE] = boost::add_edge(vert_w, vert_e, e, g).first;
+    }
+
+    // force a full refill
+    origin_x = std::numeric_limits<long>::min() / 2;
+    origin_y = std::numeric_limits<long>::min() / 2;
+    recenter(center);
+}
+
+void rolling_map::update_cell(long x, long y, time_t t) {
+    size_t s = slot(x, y);
+    double utm_x = map.get_utm_pose_x(),
+           utm_y = map.get_utm_pose_y();
+    g[2 * s    ].pt = {{utm_x + scale_x * (x - 0.5), utm_y + scale_y * (y      )}};
+    g[2 * s + 1].pt = {{utm_x + scale_x * (x      ), utm_y + scale_y * (y - 0.5)}};
+
+    float weight = get_weight(x, y);
+    edge_t* se = &edges[E_COUNT * s];
+    for (size_t i = 0; i < E_COUNT; i++) {
+        edge& e = g[se[i]];
+        if (i == E_NS)
+            e.weight = std::abs(scale_y) * weight;
+        else if (i == E_WE)
+            e.weight = std::abs(scale_x) * weight;
+        else
+            e.weight = hypotenuse * weight;
+        e.t = t;
+    }
+}
+
+void rolling_map::update_column(long x, time_t t) {
+    for (long y = origin_y; y <= origin_y + long(height); y++)
+        update_cell(x, y, t);
+}
+
+void rolling_map::update_row(long y, time_t t) {
+    for (long x = origin_x; x <= origin_x + long(width); x++)
+        update_cell(x, y, t);
+}
+
+float rolling_map::get_weight(long x, long y) const {
+    const float obstacle = std::numeric_limits<float>::infinity();
+    // guard band and out of the global map: blocked
+    if (not in_window(x, y) or x < 0 or y < 0 or
+            x >= long(map.get_width()) or y >= long(map.get_height()))
+        return obstacle;
+    float weight = map.get_weight(x, y);
+    if (weight == obstacle)
+        return obstacle;
+    if (weight <= 0) // unknown, same as nav_graph
+        return 100.0;
+    return weight;
+}
+
+void rolling_map::recenter(const point_xy_t& center) {
+    point_xy_t px = map.get_map().point_utm2pix(center[0], center[1]);
+    long new_x = std::lround(px[0]) - long(width  / 2);
+    long new_y = std::lround(px[1]) - long(height / 2);
+    long old_x = origin_x, old_y = origin_y;
+    if (new_x == old_x and new_y == old_y)
+        return;
+    origin_x = new_x;
+    origin_y = new_y;
+    time_t t = std::time(0);
+
+    // window and guard band: [origin, origin + size]
+    long dx = new_x - old_x, dy = new_y - old_y;
+    if (std::abs(dx) > long(width) or std::abs(dy) > long(height)) {
+        for (long y = new_y; y <= new_y + long(height); y++)
+            update_row(y, t);
+        return;
+    }
+    // newly exposed columns and rows
+    for (long x = new_x; x <= new_x + long(width); x++)
+        if (x < old_x or x > old_x + long(width))
+            update_column(x, t);
+    for (long y = new_y; y <= new_y + long(height); y++)
+        if (y < old_y or y > old_y + long(height))
+            update_row(y, t);
+    // the guard band moved: the old one may be in the window now,
+    // and the new one may have been in the window
+    if (old_x + long(width) < new_x + long(width))
+        update_column(old_x + width, t);
+    update_column(new_x + width, t);
+    if (old_y + long(height) < new_y + long(height))
+        update_row(old_y + height, t);
+    update_row(new_y + height, t);
+}
+
+vertex_t rolling_map::get_closest_vertex(const point_xy_t& p) const {
+    point_xy_t px = map.get_map().point_utm2pix(p[0], p[1]);
+    long x = std::lround(px[0]), y = std::lround(px[1]);
+    // clamp in the window
+    x = std::max(origin_x, std::min(origin_x + long(width)  - 1, x));
+    y = std::max(origin_y, std::min(origin_y + long(height) - 1, y));
+    // closest side of the cell
+    vertex_t sides[4] = { 2 * slot(x, y), 2 * slot(x, y) + 1,
+                          2 * slot(x + 1, y), 2 * slot(x, y + 1) + 1 };
+    vertex_t closest = sides[0];
+    for (const vertex_t& v : sides)
+        if (distance_sq(p, g[v].pt) < distance_sq(p, g[closest].pt))
+            closest = v;
+    return closest;
+}
+
+path_cost_util_t rolling_map::astar_search(const point_xy_t& start,
+        const point_xy_t& goal) const {
+    vertex_t goal_v = get_closest_vertex(goal);
+    astar_goal_visitor vis(goal_v);
+    nav_goal_heuristic heuristic(g, goal_v);
+    std::vector<vertex_t> predecessors(num_vertices(g));
+    std::vector<double> distances(boost::num_vertices(g));
+    std::vector<double> ranks(boost::num_vertices(g), -1.0);
+    std::vector<boost::default_color_type> colors(boost::num_vertices(g));
+    path_cost_util_t res;
+    res.cost = std::numeric_limits<float>::infinity();
+    try {
+        boost::astar_search(
+            g, get_closest_vertex(start), heuristic,
+            boost::predecessor_map(predecessors.data()).
+                distance_map(distances.data()).
+                weight_map(boost::get(&edge::weight, g)).
+                rank_map(ranks.data()).
+                color_map(colors.data()).
+                visitor(vis)
+        );
+    } catch (found_goal) {
+        // reached through blocked edges only: no path
+        if (distances[goal_v] >= std::numeric_limits<float>::max())
+            return res;
+        for(vertex_t v = goal_v;; v = predecessors[v]) {
+            res.path.push_front(g[v].pt);
+            if (predecessors[v] == v)
+                break;
+        }
+        res.cost = distances[goal_v];
+    }
+    return res;
+}
+
+} // namespace gladys
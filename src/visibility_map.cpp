@@ -9,8 +9,17 @@
  * license: BSD
  */
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include "gladys/visibility_map.hpp"
 #include "gladys/bresenham.hpp"
+#include "gladys/gdal_stream.hpp"
+#include "gladys/parallel.hpp"
+#include "gladys/los_kernel.hpp"
 
 // Espilon, for float comparison
 #ifndef EPS
@@ -19,12 +28,57 @@
 
 namespace gladys {
 
+/** true if a known cell d away from the sensor breaks the (s-t) line:
+ * a*d + z - zs > EPS, a = (zs - zt) / d0 (see _is_visible). Same
+ * operations as los_kernel, so that they agree bit for bit.
+ */
+static inline bool occludes(const dtm_cell& cell, double d, double a,
+                            double zs) {
+    if ( cell.n_points < 1 - EPS )
+        return false; // unknown, seen though
+    return a * d + cell.z_max - zs > 0 + EPS ;
+}
+
 void visibility_map::_load() {//{{{
     width  = dtm.get_width();
     height = dtm.get_height();
-    // TODO cache stuff
+    horizons.clear();
+    cache.invalidate();
+    _pack_cells();
+    pyramid.clear();
+    occluders.clear();
 }//}}}
 
+void visibility_map::_pack_cells() const {
+    auto has_band = [&](const std::string& name) {
+        return std::count(dtm.names.begin(), dtm.names.end(), name) > 0;
+    };
+    if (mapped or not has_band("Z_MAX") or not has_band("N_POINTS"))
+        cells.clear(); // see get_cells
+    else
+        cells.pack(get_heightmap(), get_npointsmap(), width, height,
+                   cells.is_morton());
+}
+
+void visibility_map::load_streamed(const std::string& f_dtm,
+        const std::string& f_robot_model) {
+    mapped.reset();
+    rmdl.load(f_robot_model);
+    gdal_stream stream(f_dtm);
+    std::vector<size_t> band_ids = {
+        stream.get_band_id("Z_MAX"), stream.get_band_id("N_POINTS") };
+    stream.copy_meta(dtm, band_ids.size());
+    dtm.names = {"Z_MAX", "N_POINTS"};
+    size_t w = stream.get_width();
+    stream.for_each_block(band_ids, [&](size_t row_begin, size_t row_end,
+            const std::vector<const float*>& blocks) {
+        for (size_t i = 0; i < blocks.size(); i++)
+            std::copy(blocks[i], blocks[i] + (row_end - row_begin) * w,
+                      dtm.bands[i].begin() + row_begin * w);
+    });
+    _load();
+}
+
 bool visibility_map::is_visible( const point_xy_t& s, const point_xy_t& t) const {
 
     point_xyz_t s3D = {s[0], s[1], 0};
@@ -34,7 +88,7 @@ bool visibility_map::is_visible( const point_xy_t& s, const point_xy_t& t) const
 }
 
 bool visibility_map::is_sensor_visible( const point_xy_t& s, const point_xy_t& t) const {
-    point_xyzt_t _s = rmdl.get_sensor_pose() ; // relative sensor position
+    const point_xyzt_t& _s = rmdl.get_sensor_pose() ; // relative sensor position
 
     point_xyz_t s3D = {s[0] + _s[0], s[1] + _s[1], _s[2]};
     point_xyz_t t3D = {t[0], t[1], 0};
@@ -46,8 +100,151 @@ bool visibility_map::is_sensor_visible( const point_xy_t& s, const point_xy_t& t
     return is_visible(s3D, t3D);
 }
 
+std::vector<bool> visibility_map::is_sensor_visible( const point_xy_t& s,
+        const points_t& targets) const {
+    const point_xyzt_t& _s = rmdl.get_sensor_pose() ; // relative sensor position
+    point_xy_t s2D = {s[0] + _s[0], s[1] + _s[1]};
+    // sort by azimuth then distance, identical targets end up side by side
+    std::vector<double> azimuth(targets.size()), dist(targets.size());
+    std::vector<size_t> order(targets.size());
+    for (size_t i = 0; i < targets.size(); i++) {
+        azimuth[i] = std::atan2(targets[i][1] - s2D[1], targets[i][0] - s2D[0]);
+        dist[i] = distance_sq(s2D, targets[i]);
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+        return azimuth[i] < azimuth[j] or
+              (azimuth[i] == azimuth[j] and dist[i] < dist[j]);
+    });
+
+    std::vector<char> visible(targets.size());
+    if (mapped)
+        _is_sensor_visible(dtm_tiles{*z_max_tiles, *n_points_tiles}, s,
+                           targets, order, visible);
+    else
+        _is_sensor_visible(get_cells(), s, targets, order, visible);
+    return std::vector<bool>(visible.begin(), visible.end());
+}
+
+/** the targets in order (by azimuth then distance) split across threads;
+ * in a thread, the cells of the last line are kept with the running
+ * maximum of their slopes (z - zs - EPS) / d, and reused by the next line
+ * as long as their cells match. In exact arithmetic a cell breaks the
+ * line (see occludes) iff its slope is above the one of the target,
+ * (zt - zs) / d0: the maximum answers for the shared cells when it is
+ * clearly apart from the target slope, else they are tested again with
+ * occludes. The answers are the ones of _is_visible.
+ */
+template <class Cells>
+void visibility_map::_is_sensor_visible( const Cells& cells,
+        const point_xy_t& s, const points_t& targets,
+        const std::vector<size_t>& order, std::vector<char>& visible) const {//{{{
+    const point_xyzt_t& _s = rmdl.get_sensor_pose() ; // relative sensor position
+    point_xyz_t s3D = {s[0] + _s[0], s[1] + _s[1], _s[2]};
+    point_xy_t s2D = {s3D[0], s3D[1]};
+    const double range = rmdl.get_sensor_range(), radius = rmdl.get_radius();
+    const double inf = std::numeric_limits<double>::infinity();
+
+    const pixel_transform pixels = get_pixel_transform();
+    point_xy_t ps = pixels.custom2pix(s2D);
+    long sx = std::lround(ps[0]), sy = std::lround(ps[1]);
+    double scale_x = pixels.get_scale_x(), scale_y = pixels.get_scale_y();
+
+    struct line_cell {
+        long x, y;
+        double d;     // distance to the sensor
+        dtm_cell cell;
+    };
+    parallel_for(0, order.size(), [&](size_t begin, size_t end) {
+        std::vector<line_cell> path; // cells of the last line
+        std::vector<double> profile; // running max of their slopes
+        bool s_read = false, s_known = false;
+        double zs = 0;
+        for (size_t k = begin; k < end; k++) {
+            const point_xy_t& t = targets[ order[k] ];
+            char& result = visible[ order[k] ];
+            if (k > begin and targets[ order[k - 1] ] == t) {
+                result = visible[ order[k - 1] ];
+                continue;
+            }
+            /* the trivial cases of is_sensor_visible and _is_visible */
+            point_xyz_t t3D = {t[0], t[1], 0};
+            if ( distance( s3D, t3D ) > range - EPS ) {
+                result = false;
+                continue;
+            }
+            double d0 = distance( s2D, t );
+            if ( d0 < radius + EPS ) {
+                result = true;
+                continue;
+            }
+            if (!s_read) { // the sensor cell, read once in map
+                const dtm_cell cs = cells(sx, sy);
+                s_known = cs.n_points >= 1 - EPS;
+                zs = s3D[2] + cs.z_max;
+                s_read = true;
+            }
+            point_xy_t pt = pixels.custom2pix(t);
+            long tx = std::lround(pt[0]), ty = std::lround(pt[1]);
+            const dtm_cell ct = cells(tx, ty);
+            if ( !s_known or ct.n_points < 1 - EPS ) {
+                result = false;
+                continue;
+            }
+            double zt = t3D[2] + ct.z_max;
+            double a = (zs - zt) / d0, slope = (zt - zs) / d0;
+            // well above the rounding of both forms
+            double margin = 1e-6 * (1 + std::abs(slope));
+
+            // true if one of the first n cells of the path breaks the line
+            auto prefix_hides = [&](size_t n) -> bool {
+                if ( n == 0 or profile[n - 1] < slope - margin )
+                    return false;
+                if ( profile[n - 1] > slope + margin )
+                    return true;
+                for (size_t j = 0; j < n; j++)
+                    if ( occludes(path[j].cell, path[j].d, a, zs) )
+                        return true;
+                return false;
+            };
+            size_t i = 0;
+            bool shared = true, hidden = false;
+            bresenham_walk( sx, sy, tx, ty, [&](int x, int y) -> bool {
+                if ( shared and i < path.size() and
+                     path[i].x == x and path[i].y == y ) {
+                    i++;
+                    return true;
+                }
+                if ( shared ) { // the lines diverge
+                    shared = false;
+                    path.resize(i);
+                    profile.resize(i);
+                    if ( prefix_hides(i) ) {
+                        hidden = true;
+                        return false;
+                    }
+                }
+                double dx = (x - ps[0]) * scale_x, dy = (y - ps[1]) * scale_y;
+                line_cell c = {x, y, std::sqrt( dx * dx + dy * dy ), cells(x, y)};
+                hidden = occludes(c.cell, c.d, a, zs);
+                // the cell below the sensor, if known, hides every target
+                // or none: a*0 + z - zs
+                double q = c.cell.n_points < 1 - EPS ? -inf :
+                           c.d > 0 ? (c.cell.z_max - zs - EPS) / c.d :
+                           hidden ? inf : -inf;
+                path.push_back(c);
+                profile.push_back(std::max(profile.empty() ? -inf : profile.back(), q));
+                return !hidden;
+            });
+            if ( shared ) // every cell of the line was in the last one
+                hidden = prefix_hides(i);
+            result = !hidden;
+        }
+    }, 64);
+}//}}}
+
 bool visibility_map::is_sensor_visible( const point_xyz_t& s, const point_xyz_t& t) const {
-    point_xyzt_t _s = rmdl.get_sensor_pose() ; // relative sensor position
+    const point_xyzt_t& _s = rmdl.get_sensor_pose() ; // relative sensor position
 
     point_xyz_t s3D = {s[0] + _s[0], s[1] + _s[1], s[2] + _s[2]};
     point_xyz_t t3D = {t[0], t[1], t[2]};
@@ -60,7 +257,7 @@ bool visibility_map::is_sensor_visible( const point_xyz_t& s, const point_xyz_t&
 }
 
 bool visibility_map::is_antenna_visible( const point_xy_t& a, const point_xy_t& t) const {
-    point_xyzt_t _a = rmdl.get_antenna_pose() ; // relative sensor position
+    const point_xyzt_t& _a = rmdl.get_antenna_pose() ; // relative sensor position
 
     point_xyz_t s3D = {a[0] + _a[0], a[1] + _a[1], _a[2]};
     point_xyz_t t3D = {t[0], t[1], 0};
@@ -73,7 +270,7 @@ bool visibility_map::is_antenna_visible( const point_xy_t& a, const point_xy_t&
 }
 
 bool visibility_map::is_antenna_visible( const point_xyz_t& a, const point_xyz_t& t) const {
-    point_xyzt_t _a = rmdl.get_antenna_pose() ; // relative sensor position
+    const point_xyzt_t& _a = rmdl.get_antenna_pose() ; // relative sensor position
 
     point_xyz_t s3D = {a[0] + _a[0], a[1] + _a[1], a[2] + _a[2]};
     point_xyz_t t3D = {t[0], t[1], t[2]};
@@ -85,12 +282,143 @@ bool visibility_map::is_antenna_visible( const point_xyz_t& a, const point_xyz_t
     return is_visible(s3D, t3D);
 }
 
+bool visibility_map::is_antenna_visible_approx( const point_xy_t& a,
+        const point_xy_t& t, bool conservative) const {
+    if (horizons.empty())
+        return is_antenna_visible(a, t);
+    point_xyz_t s3D, t3D;
+    int settled = _antenna_settled(a, t, conservative, s3D, t3D);
+    return settled < 0 ? is_visible(s3D, t3D) : settled;
+}
+
+bool visibility_map::is_antenna_link_approx( const point_xy_t& a,
+        const point_xy_t& b, bool conservative) const {
+    point_xyz_t ab_s, ab_t, ba_s, ba_t;
+    int ab = _antenna_settled(a, b, conservative, ab_s, ab_t);
+    if ( ab == 0 )
+        return false ;
+    int ba = _antenna_settled(b, a, conservative, ba_s, ba_t);
+    if ( ba == 0 )
+        return false ;
+    return ( ab > 0 or is_visible(ab_s, ab_t) ) and
+           ( ba > 0 or is_visible(ba_s, ba_t) );
+}
+
+/** is_antenna_visible_approx without walking the line: 1 if visible, 0
+ * if hidden, -1 if is_visible(s3D, t3D) decides. Without horizons, only
+ * the trivial cases are settled, as is_antenna_visible would.
+ */
+int visibility_map::_antenna_settled( const point_xy_t& a,
+        const point_xy_t& t, bool conservative,
+        point_xyz_t& s3D, point_xyz_t& t3D) const {
+    const point_xyzt_t& _a = rmdl.get_antenna_pose() ; // relative antenna position
+
+    /* the trivial cases of is_antenna_visible and _is_visible */
+    s3D = {a[0] + _a[0], a[1] + _a[1], _a[2]};
+    t3D = {t[0], t[1], 0};
+    if ( distance( s3D, t3D ) > rmdl.get_antenna_range() - EPS )
+        return false ;
+    point_xy_t s = {s3D[0], s3D[1]};
+    double distance_st = distance( s, t );
+    if ( distance_st < rmdl.get_radius() + EPS )
+        return true ;
+
+    const pixel_transform pixels = get_pixel_transform();
+    pixel_t ps = pixels.pixel_custom(s), pt = pixels.pixel_custom(t);
+    dtm_cell cs, ct;
+    if (mapped) {
+        cs = dtm_tiles{*z_max_tiles, *n_points_tiles}(ps[0], ps[1]);
+        ct = dtm_tiles{*z_max_tiles, *n_points_tiles}(pt[0], pt[1]);
+    } else {
+        cs = get_cells()(ps[0], ps[1]);
+        ct = get_cells()(pt[0], pt[1]);
+    }
+    if ( cs.n_points < 1 - EPS
+    ||   ct.n_points < 1 - EPS)
+        return false ;
+
+    if ( ps != pt and !horizons.empty() ) {
+        double slope = (ct.z_max - _a[2] - cs.z_max) / distance_st;
+        long dx = pt[0] - ps[0], dy = pt[1] - ps[1];
+        // above the upper horizon: no cell of the line breaks the link
+        // (margin for the rounding of the distances)
+        if ( slope > horizons.get_upper(ps[0], ps[1], dx, dy) + 1e-6 )
+            return true ;
+        if ( !conservative and horizons.has_lower() )
+            // hidden by its sector below the lower horizon before the
+            // target, above it an occluder may still be next to the line
+            return !( slope < horizons.get_lower(ps[0], ps[1], dx, dy) );
+    }
+    return -1 ;
+}
+
+void visibility_map::build_horizons(size_t sectors, size_t rings, bool lower) {
+    const point_xyzt_t& _a = rmdl.get_antenna_pose() ;
+    if (mapped)
+        horizons.build(dtm_tiles{*z_max_tiles, *n_points_tiles},
+            get_pixel_transform(), _a[2], rmdl.get_antenna_range(),
+            sectors, rings, lower, EPS);
+    else
+        horizons.build(get_cells(), get_pixel_transform(), _a[2],
+            rmdl.get_antenna_range(), sectors, rings, lower, EPS);
+}
+
+void visibility_map::load_horizons(const std::string& filepath) {
+    gdalwrap::gdal map;
+    map.load(filepath);
+    if (map.get_width() != width or map.get_height() != height)
+        throw std::runtime_error("[visibility_map] horizons of another dtm");
+    horizon_map loaded;
+    loaded.from_gdal(map, rmdl.get_antenna_pose()[2], rmdl.get_antenna_range());
+    horizons = loaded;
+}
+
 /* computing function */
-bool visibility_map::is_visible( const point_xyz_t& s3d, const point_xyz_t& t3d) const {//{{{
-    // gdalwrap::raster aka. vector<float>
-    const auto& heightmap = get_heightmap();
-    const auto& npointsmap = get_npointsmap();
+bool visibility_map::is_visible( const point_xyz_t& s3d, const point_xyz_t& t3d) const {
+    return _is_visible(s3d, t3d);
+}
+
+bool visibility_map::is_visible_cell( const pixel_t& s, double zs,
+        const pixel_t& t, double zt) const {
+    const pixel_transform pixels = get_pixel_transform();
+    if (!pixels.contains(s) or !pixels.contains(t))
+        throw std::out_of_range("[visibility_map] cell out of the dtm");
+    visibility_cache::key_type k = cache.key(pixels.index(s), zs,
+                                             pixels.index(t), zt);
+    return cache.enabled() ? cache(k) : _is_visible(k);
+}
+
+bool visibility_map::is_antenna_link_cell( const pixel_t& a, const pixel_t& b) const {
+    const pixel_transform pixels = get_pixel_transform();
+    if (!pixels.contains(a) or !pixels.contains(b))
+        throw std::out_of_range("[visibility_map] cell out of the dtm");
+    visibility_cache::key_type k = cache.link_key(pixels.index(a), pixels.index(b));
+    return cache.enabled() ? cache(k) : _is_visible(k);
+}
+
+bool visibility_map::_is_visible( const point_xyz_t& s3d, const point_xyz_t& t3d) const {
+    if (mapped)
+        return _is_visible(dtm_tiles{*z_max_tiles, *n_points_tiles}, s3d, t3d);
+    return _is_visible(get_cells(), s3d, t3d);
+}
+
+/** the test between the centers of the cells of the key */
+bool visibility_map::_is_visible( const visibility_cache::key_type& k) const {
+    const pixel_transform pixels = get_pixel_transform();
+    size_t s = std::get<1>(k), t = std::get<3>(k);
+    point_xy_t ps = pixels.pix2custom(s % width, s / width);
+    point_xy_t pt = pixels.pix2custom(t % width, t / width);
+    if (std::get<0>(k)) // link, exact (see is_antenna_visible_approx)
+        return is_antenna_link_approx(ps, pt, true);
+    return _is_visible(
+        point_xyz_t{{ps[0], ps[1], visibility_cache::height(std::get<2>(k))}},
+        point_xyz_t{{pt[0], pt[1], visibility_cache::height(std::get<4>(k))}});
+}
 
+/** Cells is packed_dtm or dtm_tiles: cells(x, y) is a dtm_cell */
+template <class Cells>
+bool visibility_map::_is_visible( const Cells& cells,
+        const point_xyz_t& s3d, const point_xyz_t& t3d) const {//{{{
     point_xy_t s = {s3d[0], s3d[1]};
     point_xy_t t = {t3d[0], t3d[1]};
 
@@ -100,16 +428,25 @@ bool visibility_map::is_visible( const point_xyz_t& s3d, const point_xyz_t& t3d)
     if ( distance_st < rmdl.get_radius()  + EPS )
         return true ;
 
+    // cells of s and t, rounded as index()
+    const pixel_transform pixels = get_pixel_transform();
+    point_xy_t ps = pixels.custom2pix(s);
+    point_xy_t pt = pixels.custom2pix(t);
+    long sx = std::lround(ps[0]), sy = std::lround(ps[1]);
+    long tx = std::lround(pt[0]), ty = std::lround(pt[1]);
+    const dtm_cell cs = cells(sx, sy), ct = cells(tx, ty);
+
     /* Check if both s and t are known (we need zmax !)
      * else we cannot say if they are visible or not,
      * and assume there is no visibility link by default */
-    if ( npointsmap[ index(s) ] < 1 - EPS
-    ||   npointsmap[ index(t) ] < 1 - EPS)
+    if ( cs.n_points < 1 - EPS
+    ||   ct.n_points < 1 - EPS)
         return false ;
 
     // From now, dist( ns, t) > 0
-    /* Get the projection of the visibility line with Bresenham's line algorithm */
-    points_t line = bresenham( s, t ) ;
+    /* Walk the projection of the visibility line with Bresenham's line
+     * algorithm, in pixels, from the cell of s to the cell of t */
+    double scale_x = pixels.get_scale_x(), scale_y = pixels.get_scale_y();
 
     /* Test the visibility link along the line  :
      * for each point from the Bresenham's line, we check the height :
@@ -120,27 +457,347 @@ bool visibility_map::is_visible( const point_xyz_t& s3d, const point_xyz_t& t3d)
     // Get the (s-t) line equation: ax + by + c = 0
     // where x = distance to the sensor (projection)
     // and y = height of the point
-    double zs, zt, d0, a, d, z;
-    zs = s3d[2] + heightmap[ index(s) ] ;   // height of the sensor
-    zt = t3d[2] + heightmap[ index(t) ] ;           // height of the target
+    double zs, zt, d0, a;
+    zs = s3d[2] + cs.z_max ;   // height of the sensor
+    zt = t3d[2] + ct.z_max ;   // height of the target
     d0 = distance_st ;
 
     a = (zs - zt) / d0 ; // d > 0
     // b = 1 and c = -zs
 
-    // test the condition for each point of the line
-    for ( auto& p: line) {
-        // if p is unknown (never observed), then assume we can see though it.
-        if ( npointsmap[ index(p) ] < 1 - EPS )
+    /* Hierarchical rejection: a node of the Z_MAX pyramid cannot break
+     * the link if a*d + zmax - zs <= EPS over the whole node, d ranging
+     * between the nearest and farthest node cell to the sensor: monotonic
+     * in d, the bound is checked at the farthest if a > 0, the nearest
+     * else (and is exact: the rounding of each operation is monotonic).
+     * The walk jumps to where the line leaves such a node, touching a
+     * few nodes instead of every cell. As a node bounds its children, a
+     * node breaking the test means its parent breaks it too: climb from
+     * level 1 while nodes pass, and test the cell itself otherwise.
+     */
+    const raster_pyramid& overviews = get_occluders();
+    auto node_passes = [&](size_t level, long nx, long ny) -> bool {
+        const pyramid_level& node = overviews.get_level(level);
+        long x0 = nx << level, y0 = ny << level;
+        long x1 = std::min(long(width),  (nx + 1) << level) - 1;
+        long y1 = std::min(long(height), (ny + 1) << level) - 1;
+        // nearest and farthest offsets from the sensor, along each axis
+        auto span = [](double c, long lo, long hi, double scale,
+                       double& dmin, double& dmax) {
+            double dlo = std::abs((lo - c) * scale), dhi = std::abs((hi - c) * scale);
+            dmin = (lo <= c and c <= hi) ? 0 : std::min(dlo, dhi);
+            dmax = std::max(dlo, dhi);
+        };
+        double dmin_x, dmax_x, dmin_y, dmax_y;
+        span(ps[0], x0, x1, scale_x, dmin_x, dmax_x);
+        span(ps[1], y0, y1, scale_y, dmin_y, dmax_y);
+        double d = a > 0 ? std::sqrt( dmax_x * dmax_x + dmax_y * dmax_y )
+                         : std::sqrt( dmin_x * dmin_x + dmin_y * dmin_y );
+        return !( a * d + node.max[ nx + ny * node.width ] - zs > 0 + EPS );
+    };
+    size_t levels = overviews.size();
+
+    // test the condition for each point of the line, up to the first
+    // occluder. Occluders are most often right next to the sensor: the
+    // first cells are tested one by one, then 8 at a time (see los_kernel)
+    los_kernel_t occluded = get_los_kernel();
+    los_batch batch;
+    size_t tested = 0;
+    bresenham_line line( sx, sy, tx, ty );
+    for (;;) {
+        long x = line.x(), y = line.y();
+        size_t level = 0; // of the largest node passing the test
+        while ( level < levels and
+                node_passes(level + 1, x >> (level + 1), y >> (level + 1)) )
+            level++;
+        if ( level > 0 ) {
+            // jump to the first cell of the line out of the node
+            long nx = x >> level, ny = y >> level;
+            long n = line.steps_in(nx << level, ny << level,
+                ((nx + 1) << level) - 1, ((ny + 1) << level) - 1);
+            if ( n > line.remaining() )
+                break; // the target is in the node
+            line.advance(n);
             continue;
-        d = distance( s, p ) ;
-        z = heightmap[ index(p) ] ;
-        if ( a*d + z - zs > 0 + EPS )
-            return false ;
+        }
+
+        const dtm_cell cell = cells(x, y);
+        if ( tested < los_batch::size ) {
+            tested++;
+            double dx = (x - ps[0]) * scale_x, dy = (y - ps[1]) * scale_y;
+            if ( occludes(cell, std::sqrt( dx * dx + dy * dy ), a, zs) )
+                return false;
+        } else {
+            size_t i = batch.count++;
+            batch.dx[i] = (x - ps[0]) * scale_x;
+            batch.dy[i] = (y - ps[1]) * scale_y;
+            batch.z[i] = cell.z_max;
+            batch.n[i] = cell.n_points;
+            if ( batch.count == los_batch::size ) {
+                if ( occluded( batch, zs, a, 1 - EPS, 0 + EPS ) )
+                    return false;
+                batch.count = 0;
+            }
+        }
+        if ( line.remaining() == 0 )
+            break;
+        line.advance(1);
+    }
+    return !( batch.count > 0 and
+              occluded( batch, zs, a, 1 - EPS, 0 + EPS ) );
+}//}}}
+
+
+gdalwrap::raster visibility_map::viewshed( const point_xy_t& s ) const {
+    if (mapped)
+        return _viewshed(dtm_tiles{*z_max_tiles, *n_points_tiles}, s);
+    return _viewshed(get_cells(), s);
+}
+
+/** Franklin and Ray's R2 sweep, made exact: rays are cast from the sensor
+ * cell to the border of the box, and the line from the sensor to a cell
+ * T of a ray is bounded by the ray. After j major steps, a line (du, dv)
+ * is v = ceil((j * dv - h) / du) minor steps away, h = floor(du / 2):
+ * T being on the ray, the fraction of its line is within [-1/2, 1/2 +
+ * 1/(2j)) of the one of the ray, so that its cell is the one of the ray,
+ * the one before if g = v * du - j * dv + h >= du / 2, or the one after
+ * if 2 * j * g < (j + 1) * du. Over these 2 or 3 cells at each step:
+ *   lower = running max of min(window slopes) <= max slope of the line
+ *   upper = running max of max(window slopes) >= max slope of the line
+ * the slopes being the ones of _is_sensor_visible, (z - zs - EPS) / d.
+ * T is hidden if lower is clearly above its slope, visible if upper is
+ * clearly below; the other cells (near the horizon, or missed by the
+ * rays) are tested on their own line by the batched is_sensor_visible.
+ */
+template <class Cells>
+gdalwrap::raster visibility_map::_viewshed( const Cells& cells,
+        const point_xy_t& s) const {//{{{
+    gdalwrap::raster visible(width * height, 0);
+    const point_xyzt_t& pose = rmdl.get_sensor_pose() ;
+    const double range = rmdl.get_sensor_range(), radius = rmdl.get_radius();
+    const double inf = std::numeric_limits<double>::infinity();
+    point_xyz_t s3D = {s[0] + pose[0], s[1] + pose[1], pose[2]};
+    point_xy_t s2D = {s3D[0], s3D[1]};
+    const pixel_transform pixels = get_pixel_transform();
+    pixel_t px = pixels.pixel_custom(s2D);
+    if (!pixels.contains(px))
+        return visible;
+    // bounding box of the range, in pixels
+    double scale_x = pixels.get_scale_x(), scale_y = pixels.get_scale_y();
+    long rx = std::ceil(range / std::abs(scale_x)) + 1;
+    long ry = std::ceil(range / std::abs(scale_y)) + 1;
+    long x0 = std::max(0L, px[0] - rx), x1 = std::min(long(width)  - 1, px[0] + rx);
+    long y0 = std::max(0L, px[1] - ry), y1 = std::min(long(height) - 1, px[1] + ry);
+    long box_width = x1 - x0 + 1;
+    std::vector<char> decided(box_width * (y1 - y0 + 1), 0);
+
+    // cell of s, rounded as index()
+    point_xy_t ps = pixels.custom2pix(s2D);
+    long sx = std::lround(ps[0]), sy = std::lround(ps[1]);
+    bool s_in = sx >= 0 and sy >= 0 and sx < long(width) and sy < long(height);
+    const dtm_cell cs = s_in ? cells(sx, sy) : dtm_cell();
+    bool s_known = s_in and cs.n_points >= 1 - EPS;
+    double zs = s3D[2] + cs.z_max;
+
+    auto ground_distance = [&](long x, long y) -> double {
+        double dx = (x - ps[0]) * scale_x, dy = (y - ps[1]) * scale_y;
+        return std::sqrt( dx * dx + dy * dy );
+    };
+    // see _is_sensor_visible
+    auto slope_of = [&](long x, long y) -> double {
+        const dtm_cell cell = cells(x, y);
+        if ( cell.n_points < 1 - EPS )
+            return -inf;
+        double d = ground_distance(x, y);
+        if ( d > 0 )
+            return (cell.z_max - zs - EPS) / d;
+        return occludes(cell, 0, 0, zs) ? inf : -inf;
+    };
+    // the answer of is_sensor_visible for T, if the bounds settle it
+    auto decide = [&](long x, long y, double lower, double upper) {
+        char& done = decided[ (x - x0) + (y - y0) * box_width ];
+        if ( done )
+            return;
+        size_t idx = x + y * width;
+        /* the trivial cases of is_sensor_visible and _is_visible */
+        point_xy_t t = pixels.pix2custom(x, y);
+        point_xyz_t t3D = {t[0], t[1], 0};
+        done = 1;
+        if ( distance( s3D, t3D ) > range - EPS )
+            return;
+        double d0 = distance( s2D, t );
+        if ( d0 < radius + EPS ) {
+            visible[ idx ] = 1;
+            return;
+        }
+        const dtm_cell ct = cells(x, y);
+        if ( ct.n_points < 1 - EPS )
+            return;
+        double zt = t3D[2] + ct.z_max;
+        double a = (zs - zt) / d0, slope = (zt - zs) / d0;
+        double margin = 1e-6 * (1 + std::abs(slope));
+        if ( lower > slope + margin or occludes(ct, ground_distance(x, y), a, zs) )
+            return;
+        if ( upper < slope - margin )
+            visible[ idx ] = 1;
+        else
+            done = 0; // too close to call
+    };
+    auto cast = [&](long ex, long ey) {
+        bool steep = std::abs(ey - sy) > std::abs(ex - sx);
+        long du = steep ? std::abs(ey - sy) : std::abs(ex - sx);
+        long dv = steep ? std::abs(ex - sx) : std::abs(ey - sy);
+        long vstep = ( steep ? sx < ex : sy < ey ) ? 1 : -1;
+        double lower = -inf, upper = -inf;
+        long j = 0;
+        bresenham_walk( sx, sy, ex, ey, [&](int x, int y) -> bool {
+            if ( j == 0 ) { // the first cell of every line
+                lower = upper = slope_of(x, y);
+                j++;
+                return true;
+            }
+            if ( ground_distance(x, y) > range )
+                return false;
+            decide(x, y, lower, upper);
+            long v = std::abs(steep ? x - sx : y - sy);
+            long g = v * du - j * dv + du / 2;
+            double wmin = slope_of(x, y), wmax = wmin;
+            for (long k : {-1L, 1L}) {
+                if ( k < 0 ? 2 * g < du : 2 * j * g >= (j + 1) * du )
+                    continue;
+                long wx = steep ? x + k * vstep : x, wy = steep ? y : y + k * vstep;
+                if ( wx < 0 or wy < 0 or wx >= long(width) or wy >= long(height) )
+                    continue; // the line stays in the dtm
+                double q = slope_of(wx, wy);
+                wmin = std::min(wmin, q);
+                wmax = std::max(wmax, q);
+            }
+            lower = std::max(lower, wmin);
+            upper = std::max(upper, wmax);
+            j++;
+            return true;
+        });
+    };
+    if ( s_known and x0 <= sx and sx <= x1 and y0 <= sy and sy <= y1 ) {
+        for (long x = x0; x <= x1; x++) {
+            cast(x, y0);
+            cast(x, y1);
+        }
+        for (long y = y0 + 1; y < y1; y++) {
+            cast(x0, y);
+            cast(x1, y);
+        }
     }
 
-    return true ;
+    // the cells left in range, on their own line
+    points_t targets;
+    std::vector<size_t> index;
+    for (long y = y0; y <= y1; y++)
+    for (long x = x0; x <= x1; x++) {
+        if ( decided[ (x - x0) + (y - y0) * box_width ] or
+             ground_distance(x, y) > range ) // out of range
+            continue;
+        targets.push_back(pixels.pix2custom(x, y));
+        index.push_back(x + y * width);
+    }
+    std::vector<bool> seen = is_sensor_visible(s, targets);
+    for (size_t i = 0; i < targets.size(); i++)
+        visible[ index[i] ] = seen[i];
+    return visible;
 }//}}}
 
+gdalwrap::raster visibility_map::viewshed_approx( const point_xy_t& s ) const {
+    if (mapped)
+        return _viewshed_approx(dtm_tiles{*z_max_tiles, *n_points_tiles}, s);
+    return _viewshed_approx(get_cells(), s);
+}
+
+template <class Cells>
+gdalwrap::raster visibility_map::_viewshed_approx( const Cells& cells,
+        const point_xy_t& s) const {//{{{
+    gdalwrap::raster visible(width * height, 0);
+    const point_xyzt_t& pose = rmdl.get_sensor_pose() ;
+    double range  = rmdl.get_sensor_range();
+    double radius = rmdl.get_radius();
+    point_xy_t s2d = {s[0] + pose[0], s[1] + pose[1]};
+    const pixel_transform pixels = get_pixel_transform();
+    point_xy_t ps = pixels.custom2pix(s2d);
+    long sx = std::lround(ps[0]), sy = std::lround(ps[1]);
+    if (sx < 0 or sy < 0 or sx >= long(width) or sy >= long(height)
+        or range - EPS < std::abs(pose[2]))
+        return visible;
+
+    double scale_x = pixels.get_scale_x(), scale_y = pixels.get_scale_y();
+    // horizontal distance from the sensor to a cell center
+    auto ground_distance = [&](long x, long y) -> double {
+        double dx = (x - ps[0]) * scale_x, dy = (y - ps[1]) * scale_y;
+        return std::sqrt( dx * dx + dy * dy );
+    };
+    // see is_sensor_visible: the target is on the ground
+    auto in_range = [&](double d) -> bool {
+        return std::sqrt( d * d + pose[2] * pose[2] ) <= range - EPS;
+    };
+    auto known = [&](const dtm_cell& cell) -> bool {
+        return cell.n_points >= 1 - EPS;
+    };
+
+    const dtm_cell cs = cells(sx, sy);
+    bool s_known = known(cs);
+    double zs = pose[2] + cs.z_max ; // height of the sensor
+
+    // bounding box of the range, in pixels
+    double reach = range - EPS;
+    long rx = std::ceil(reach / std::abs(scale_x)) + 1;
+    long ry = std::ceil(reach / std::abs(scale_y)) + 1;
+    long x0 = std::max(0L, sx - rx), x1 = std::min(long(width)  - 1, sx + rx);
+    long y0 = std::max(0L, sy - ry), y1 = std::min(long(height) - 1, sy + ry);
+
+    std::vector<bool> reached(width * height, false);
+    auto cast = [&](long ex, long ey) {
+        // maximum of (z - zs - EPS) / d over the cells met: a target is
+        // hidden if its slope (zt - zs) / d0 is below (see
+        // _is_sensor_visible)
+        double max_slope = -std::numeric_limits<double>::infinity();
+        bresenham_walk( sx, sy, ex, ey, [&](int x, int y) -> bool {
+            size_t idx = x + y * width;
+            double d = ground_distance(x, y);
+            if ( !in_range(d) )
+                return false;
+            reached[ idx ] = true;
+            if ( d < radius + EPS )
+                visible[ idx ] = 1;
+            const dtm_cell cell = cells(x, y);
+            if ( !known(cell) )
+                return true; // can see though it
+            double z = cell.z_max;
+            if ( s_known and d > 0 and (z - zs) / d >= max_slope )
+                visible[ idx ] = 1;
+            if ( d > 0 )
+                max_slope = std::max(max_slope, (z - zs - EPS) / d);
+            return true;
+        });
+    };
+    for (long x = x0; x <= x1; x++) {
+        cast(x, y0);
+        cast(x, y1);
+    }
+    for (long y = y0 + 1; y < y1; y++) {
+        cast(x0, y);
+        cast(x1, y);
+    }
+
+    // cells in range missed by the rays, if any
+    point_xyz_t s3d = {s2d[0], s2d[1], pose[2]};
+    for (long y = y0; y <= y1; y++)
+    for (long x = x0; x <= x1; x++) {
+        size_t idx = x + y * width;
+        if ( reached[ idx ] or !in_range(ground_distance(x, y)) )
+            continue;
+        point_xy_t t = pixels.pix2custom(x, y);
+        point_xyz_t t3d = {t[0], t[1], 0};
+        visible[ idx ] = _is_visible(cells, s3d, t3d);
+    }
+    return visible;
+}//}}}
 
 } // namespace gladys
@@ -8,30 +8,311 @@
  * license: BSD
  */
 #include <cmath>
+#include <algorithm>
 #include <map>
+#include <limits>
+#include <vector>
+#include <stdexcept>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "gdalwrap/gdal.hpp"
 #include "gladys/weight_map.hpp"
+#include "gladys/parallel.hpp"
+#include "gladys/gdal_stream.hpp"
 
 namespace gladys {
 
-void costmap::_load() {
-    assert(terrains.bands.size() > 1);
-    map.copy_meta(terrains, 1);
-    gdalwrap::raster& weights = map.bands[0];
-    width = map.get_width();
-    map.names[0] = "WEIGHT";
-    for (size_t pos = 0; pos < width * map.get_height(); pos++) {
-        if (terrains.bands[1][pos] < 100) // confidence bellow 100 -> unknown
-            weights[pos] = W_UNKNOWN;
-        else if (terrains.bands[0][pos] > 252) // TODO tune this threshold
-            weights[pos] = std::numeric_limits<float>::infinity(); // obstacle
+/** rows below which splitting the load over threads is not worth it */
+static const size_t min_rows_per_thread = 64;
+
+namespace {
+
+#ifdef __SSE2__
+/** per-lane select: mask ? a : b */
+inline __m128 select_ps(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/** 4 floats compared with `op` against a double, as the scalar code does */
+template <class Op>
+inline __m128 compare_pd(__m128 x, __m128d threshold, Op op) {
+    __m128d lo = op(_mm_cvtps_pd(x), threshold);
+    __m128d hi = op(_mm_cvtps_pd(_mm_movehl_ps(x, x)), threshold);
+    return _mm_shuffle_ps(_mm_castpd_ps(lo), _mm_castpd_ps(hi),
+                          _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+/** 4 floats divided by a double, rounded back to float */
+inline __m128 div_pd(__m128 x, __m128d divisor) {
+    __m128d lo = _mm_div_pd(_mm_cvtps_pd(x), divisor);
+    __m128d hi = _mm_div_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)), divisor);
+    return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+#endif
+
+/** costmap kernel for pixels [begin, end) */
+void costmap_kernel(const float* cost, const float* confidence, double velocity,
+        float unknown, float* weights, size_t begin, size_t end) {
+    const float obstacle = std::numeric_limits<float>::infinity();
+    size_t pos = begin;
+#ifdef __SSE2__
+    const __m128d v_velocity = _mm_set1_pd(velocity);
+    const __m128d v_one = _mm_set1_pd(1.0);
+    const __m128 v_unknown = _mm_set1_ps(unknown);
+    const __m128 v_obstacle = _mm_set1_ps(obstacle);
+    for (; pos + 4 <= end; pos += 4) {
+        __m128 c = _mm_loadu_ps(cost + pos);
+        __m128 f = _mm_loadu_ps(confidence + pos);
+        // 1 + cost / velocity, in double
+        __m128d lo = _mm_add_pd(v_one, _mm_div_pd(_mm_cvtps_pd(c), v_velocity));
+        __m128d hi = _mm_add_pd(v_one, _mm_div_pd(
+                        _mm_cvtps_pd(_mm_movehl_ps(c, c)), v_velocity));
+        __m128 w = _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+        w = select_ps(_mm_cmpgt_ps(c, _mm_set1_ps(252)), v_obstacle, w);
+        w = select_ps(_mm_cmplt_ps(f, _mm_set1_ps(100)), v_unknown, w);
+        _mm_storeu_ps(weights + pos, w);
+    }
+#endif
+    for (; pos < end; pos++) {
+        if (confidence[pos] < 100) // confidence bellow 100 -> unknown
+            weights[pos] = unknown;
+        else if (cost[pos] > 252) // TODO tune this threshold
+            weights[pos] = obstacle;
+        else
+            weights[pos] = 1 + cost[pos] / velocity;
+    }
+}
+
+/** weight_map kernel for pixels [begin, end)
+ *
+ * classes are accumulated in the order of coefs (the cost names order, see
+ * cost_model), so that the result is the same whatever the path taken
+ * (SIMD or scalar).
+ */
+void weight_map_kernel(const std::vector<float>& coefs,
+        const std::vector<const float*>& classes,
+        const float* no_3d_class, double no_3d_threshold,
+        const float* obstacle, double obstacle_threshold,
+        double velocity, float unknown, float* weights,
+        size_t begin, size_t end) {
+    const float inf = std::numeric_limits<float>::infinity();
+    size_t pos = begin;
+#ifdef __SSE2__
+    const __m128d v_velocity = _mm_set1_pd(velocity);
+    const __m128d v_no_3d_threshold = _mm_set1_pd(no_3d_threshold);
+    const __m128d v_obstacle_threshold = _mm_set1_pd(obstacle_threshold);
+    const __m128 v_unknown = _mm_set1_ps(unknown);
+    const __m128 v_inf = _mm_set1_ps(inf);
+    auto greater = [](__m128d a, __m128d b) { return _mm_cmpgt_pd(a, b); };
+    for (; pos + 4 <= end; pos += 4) {
+        __m128 w = _mm_set1_ps(1.0f);
+        for (size_t k = 0; k < coefs.size(); k++)
+            w = _mm_add_ps(w, _mm_mul_ps(_mm_set1_ps(coefs[k]),
+                                         _mm_loadu_ps(classes[k] + pos)));
+        w = div_pd(w, v_velocity);
+        w = select_ps(compare_pd(_mm_loadu_ps(obstacle + pos),
+                        v_obstacle_threshold, greater), v_inf, w);
+        w = select_ps(compare_pd(_mm_loadu_ps(no_3d_class + pos),
+                        v_no_3d_threshold, greater), v_unknown, w);
+        _mm_storeu_ps(weights + pos, w);
+    }
+#endif
+    for (; pos < end; pos++) {
+        if (no_3d_class[pos] > no_3d_threshold)
+            weights[pos] = unknown; // UNKNOWN
+        else if (obstacle[pos] > obstacle_threshold)
+            weights[pos] = inf; // OBSTACLE
         else {
-            weights[pos] = 1 + terrains.bands[0][pos] / rmdl.get_velocity();
+            float weight = 1.0;
+            for (size_t k = 0; k < coefs.size(); k++)
+                weight += coefs[k] * classes[k][pos];
+            weights[pos] = weight / velocity;
         }
     }
 }
 
+/** 1D squared euclidean distance transform (Felzenszwalb & Huttenlocher)
+ *
+ * in place on the n samples f[0], f[stride], ..., spaced by `spacing` meters;
+ * infinite samples are not part of the lower envelope.
+ * v, z and d are scratch buffers (resized as needed).
+ */
+void edt_1d(float* f, size_t n, size_t stride, double spacing,
+        std::vector<size_t>& v, std::vector<double>& z, std::vector<double>& d) {
+    const double inf = std::numeric_limits<double>::infinity();
+    v.resize(n);
+    z.resize(n + 1);
+    d.resize(n);
+    // lower envelope of the parabolas rooted at finite samples
+    long k = -1;
+    for (size_t q = 0; q < n; q++) {
+        double fq = f[q * stride];
+        if (fq == inf)
+            continue;
+        double pq = q * spacing;
+        while (k >= 0) {
+            double pv = v[k] * spacing;
+            double s = ((fq + pq * pq) - (f[v[k] * stride] + pv * pv))
+                     / (2 * (pq - pv));
+            if (s > z[k]) {
+                k++;
+                v[k] = q;
+                z[k] = s;
+                z[k + 1] = inf;
+                break;
+            }
+            k--; // parabola v[k] is hidden by q
+        }
+        if (k < 0) {
+            k = 0;
+            v[0] = q;
+            z[0] = -inf;
+            z[1] = inf;
+        }
+    }
+    if (k < 0)
+        return; // no finite sample, all stay infinite
+    // sample the envelope
+    k = 0;
+    for (size_t q = 0; q < n; q++) {
+        double pq = q * spacing;
+        while (z[k + 1] < pq)
+            k++;
+        double delta = pq - v[k] * spacing;
+        d[q] = delta * delta + f[v[k] * stride];
+    }
+    for (size_t q = 0; q < n; q++)
+        f[q * stride] = d[q];
+}
+
+} // namespace
+
+void weight_map::inflate_obstacles(double falloff) {
+    if (weight_tiles or quantized)
+        throw std::runtime_error("[weight_map] weight band is read-only");
+    pyramid.clear();
+    gdalwrap::raster& weights = map.bands[0];
+    size_t w = map.get_width(), h = map.get_height();
+    double radius = rmdl.get_radius();
+    if (w == 0 or h == 0 or (radius <= 0 and falloff <= 0))
+        return;
+    // squared distance (in meters) to the nearest obstacle
+    std::vector<float> dist2(weights.size());
+    for (size_t pos = 0; pos < weights.size(); pos++)
+        dist2[pos] = is_obstacle(weights[pos]) ? 0 :
+            std::numeric_limits<float>::infinity();
+
+    double spacing_x = std::abs(map.get_scale_x());
+    double spacing_y = std::abs(map.get_scale_y());
+    // columns, then rows: separable, linear in the number of pixels
+    parallel_for(0, w, [&](size_t col_begin, size_t col_end) {
+        std::vector<size_t> v;
+        std::vector<double> z, d;
+        for (size_t col = col_begin; col < col_end; col++)
+            edt_1d(&dist2[col], h, w, spacing_y, v, z, d);
+    }, min_rows_per_thread);
+    parallel_for(0, h, [&](size_t row_begin, size_t row_end) {
+        std::vector<size_t> v;
+        std::vector<double> z, d;
+        for (size_t row = row_begin; row < row_end; row++)
+            edt_1d(&dist2[row * w], w, 1, spacing_x, v, z, d);
+    }, min_rows_per_thread);
+
+    // unknown areas are left as is, they are not known to be free
+    double outer = radius + falloff;
+    const float inf = std::numeric_limits<float>::infinity();
+    parallel_for(0, h, [&](size_t row_begin, size_t row_end) {
+        for (size_t pos = row_begin * w; pos < row_end * w; pos++) {
+            float& weight = weights[pos];
+            if (weight <= 0 or is_obstacle(weight))
+                continue;
+            double dist = std::sqrt(dist2[pos]);
+            if (dist <= radius)
+                weight = inf;
+            else if (dist < outer)
+                weight *= 1 + (outer - dist) / falloff;
+        }
+    }, min_rows_per_thread);
+}
+
+void costmap::_load() {
+    _setup();
+    const float* cost       = terrains->bands[0].data();
+    const float* confidence = terrains->bands[1].data();
+    double velocity = rmdl.get_velocity();
+    float* data = map.bands[0].data();
+    size_t w = width;
+    parallel_for(0, map.get_height(), [&](size_t row_begin, size_t row_end) {
+        costmap_kernel(cost, confidence, velocity, W_UNKNOWN, data,
+                       row_begin * w, row_end * w);
+    }, min_rows_per_thread);
+
+    if (rmdl.get_inflate())
+        inflate_obstacles(rmdl.get_inflation_falloff());
+}
+
+namespace {
+
+/** pointers to the region bands, by band index */
+std::vector<const float*> band_pointers(const gdalwrap::gdal& terrains) {
+    std::vector<const float*> bands;
+    for (const auto& band : terrains.bands)
+        bands.push_back(band.data());
+    return bands;
+}
+
+/** weight_map kernel bound to region bands and a cost model */
+class blend_job {
+    std::vector<float> coefs;
+    std::vector<const float*> classes;
+    const float* no_3d_class;
+    const float* obstacle;
+    double no_3d_threshold, obstacle_threshold, velocity;
+    float unknown;
+    float* weights;
+public:
+    /**
+     * @param model cost model compiled against the region band layout
+     * @param bands region band data, by band index (may be NULL if unused)
+     */
+    blend_job(const cost_model& model, const std::vector<const float*>& bands,
+              double _velocity, float _unknown, float* _weights) {
+        // every cost class, in the order of the sum
+        for (size_t band : model.cost_bands) {
+            coefs.push_back(model.coefs[band]);
+            classes.push_back(bands[band]);
+        }
+        no_3d_class = bands[model.unknown_band];
+        no_3d_threshold = model.unknown_threshold;
+        obstacle = bands[model.obstacle_band];
+        obstacle_threshold = model.obstacle_threshold;
+        velocity = _velocity;
+        unknown = _unknown;
+        weights = _weights;
+    }
+    /** blend pixels [begin, end) */
+    void operator()(size_t begin, size_t end) const {
+        weight_map_kernel(coefs, classes, no_3d_class, no_3d_threshold,
+                          obstacle, obstacle_threshold, velocity,
+                          unknown, weights, begin, end);
+    }
+};
+
+} // namespace
+
+void weight_map::_setup() {
+    assert(terrains->bands.size() > 1);
+    mapped.reset();
+    weight_tiles = nullptr;
+    quantized.reset();
+    pyramid.clear();
+    map.copy_meta(*terrains, 1);
+    width = map.get_width();
+    map.names[0] = "WEIGHT";
+}
+
 /** compute a mix of ponderated classes
  *
  * w/ threshold on obstacle and unknown
@@ -39,61 +320,94 @@ void costmap::_load() {
  *          (in seconds per meter)
  */
 void weight_map::_load() {
-    assert(terrains.bands.size() > 1);
-    map.copy_meta(terrains, 1);
-    gdalwrap::raster& weights = map.bands[0];
+    _setup();
+    blend_job blend(rmdl.compile_costs(terrains->names),
+        band_pointers(*terrains), rmdl.get_velocity(), W_UNKNOWN,
+        map.bands[0].data());
+    size_t w = width;
+    parallel_for(0, map.get_height(), [&](size_t row_begin, size_t row_end) {
+        blend(row_begin * w, row_end * w);
+    }, min_rows_per_thread);
+
+    if (rmdl.get_inflate())
+        inflate_obstacles(rmdl.get_inflation_falloff());
+}
+
+void weight_map::load_streamed(const std::string& f_region,
+        const std::string& f_robot_model) {
+    rmdl.load(f_robot_model);
+    gdal_stream region(f_region);
+    terrains.reset(new gdalwrap::gdal()); // terrains are not kept
+    mapped.reset();
+    weight_tiles = nullptr;
+    quantized.reset();
+    pyramid.clear();
+    region.copy_meta(map, 1);
     width = map.get_width();
     map.names[0] = "WEIGHT";
 
-    float weight = 1.0;
-    std::map<std::string, float> costs = rmdl.get_costs();
-    size_t idx_no_3d_class = terrains.get_band_id("NO_3D_CLASS");
-    size_t idx_obstacle    = terrains.get_band_id("OBSTACLE");
+    // read only the bands the cost model uses
+    cost_model model = rmdl.compile_costs(region.get_names());
+    std::vector<size_t> band_ids(model.cost_bands);
+    band_ids.push_back(model.unknown_band);
+    band_ids.push_back(model.obstacle_band);
+    std::sort(band_ids.begin(), band_ids.end());
+    band_ids.erase(std::unique(band_ids.begin(), band_ids.end()), band_ids.end());
 
-    for (size_t pos = 0; pos < width * map.get_height(); pos++) {
-        if (terrains.bands[idx_no_3d_class][pos] > 0.9)
-            weights[pos] = W_UNKNOWN; // UNKNOWN
-        else if (terrains.bands[idx_obstacle][pos] > 0.4) // TODO tune this threshold
-            weights[pos] = std::numeric_limits<float>::infinity(); // OBSTACLE
-        else {
-            weight = 1.0;
-            // compute a mix of ponderated classes TODO dynamicaly json conf
-            for (const auto& kv : costs)
-                weight += kv.second * terrains.get_band(kv.first)[pos];
+    double velocity = rmdl.get_velocity();
+    size_t w = width;
+    region.for_each_block(band_ids, [&](size_t row_begin, size_t row_end,
+            const std::vector<const float*>& blocks) {
+        std::vector<const float*> bands(model.coefs.size(), NULL);
+        for (size_t i = 0; i < band_ids.size(); i++)
+            bands[band_ids[i]] = blocks[i];
+        blend_job blend(model, bands, velocity, W_UNKNOWN,
+                        map.bands[0].data() + row_begin * w);
+        parallel_for(0, row_end - row_begin, [&](size_t begin, size_t end) {
+            blend(begin * w, end * w);
+        }, min_rows_per_thread);
+    });
 
-            weights[pos] = weight / rmdl.get_velocity();
-        }
-    }
+    if (rmdl.get_inflate())
+        inflate_obstacles(rmdl.get_inflation_falloff());
+}
 
-#if 0
-    // inflate obstacle by robot radius relative to map scale {x,y}
-
-    // averaged up raduis {x,y}
-    size_t rx = std::floor( map.get_scale_x() * rmdl.get_radius() );
-    size_t ry = std::floor( map.get_scale_y() * rmdl.get_radius() );
-
-    for (size_t px_x = rx; px_x < width  - rx; px_x++)
-    for (size_t px_y = ry; px_y < map.get_height() - ry; px_y++) {
-        if ( is_obstacle(weights[px_x + px_y * width]) ) {
-            for (size_t irx = 1; irx <= rx; irx++)
-            for (size_t iry = 1; iry <= ry; iry++) {
-                flag_as_obstacle(weights[px_x       + (px_y - iry) * width]);
-                flag_as_obstacle(weights[px_x       + (px_y + iry) * width]);
-                flag_as_obstacle(weights[px_x - irx + (px_y      ) * width]);
-                flag_as_obstacle(weights[px_x - irx + (px_y - iry) * width]);
-                flag_as_obstacle(weights[px_x - irx + (px_y + iry) * width]);
-                flag_as_obstacle(weights[px_x + irx + (px_y      ) * width]);
-                flag_as_obstacle(weights[px_x + irx + (px_y - iry) * width]);
-                flag_as_obstacle(weights[px_x + irx + (px_y + iry) * width]);
-            }
-        }
+std::vector<weight_map> make_weight_maps(
+        std::shared_ptr<const gdalwrap::gdal> terrains,
+        const std::vector<robot_model>& robots) {
+    std::vector<weight_map> maps(robots.size());
+    std::vector<blend_job> blends;
+    for (size_t i = 0; i < robots.size(); i++) {
+        maps[i].terrains = terrains;
+        maps[i].rmdl = robots[i];
+        maps[i]._setup();
+        blends.push_back(blend_job(robots[i].compile_costs(terrains->names),
+            band_pointers(*terrains), robots[i].get_velocity(),
+            weight_map::W_UNKNOWN, maps[i].map.bands[0].data()));
     }
-    // see http://www.ros.org/wiki/costmap_2d#Inflation
-    for (auto& weight : weights)
-        if (is_flag_obstacle(weight))
-            weight = 99;
-#endif
+    if (maps.empty())
+        return maps;
+
+    // row by row, all the robots: the terrain rows are read from memory
+    // once and stay in cache for the next robots
+    size_t w = maps[0].width;
+    parallel_for(0, maps[0].get_height(), [&](size_t row_begin, size_t row_end) {
+        for (size_t row = row_begin; row < row_end; row++)
+            for (const auto& blend : blends)
+                blend(row * w, (row + 1) * w);
+    }, min_rows_per_thread);
+
+    for (auto& wm : maps)
+        if (wm.rmdl.get_inflate())
+            wm.inflate_obstacles(wm.rmdl.get_inflation_falloff());
+    return maps;
+}
 
+std::vector<weight_map> make_weight_maps(const std::string& f_region,
+        const std::vector<robot_model>& robots) {
+    std::shared_ptr<gdalwrap::gdal> terrains(new gdalwrap::gdal());
+    terrains->load(f_region);
+    return make_weight_maps(terrains, robots);
 }
 
 } // namespace gladys
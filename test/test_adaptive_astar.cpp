@@ -0,0 +1,103 @@
+/*
+ * test_adaptive_astar.cpp
+ *
+ * Test the Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-18
+ * license: BSD
+ */
+#define BOOST_TEST_MODULE const_string test
+#include <boost/test/included/unit_test.hpp>
+
+#include <string>
+#include <fstream>
+
+#include "gdalwrap/gdal.hpp"
+#include "gladys/nav_graph.hpp"
+#include "gladys/adaptive_astar.hpp"
+
+using namespace gladys;
+
+namespace {
+
+/** a 20x20 region with a wall and a single gap on its left side */
+weight_map make_wall_map(const std::string& name) {
+    std::string region_path = "/tmp/" + name + ".tif";
+    std::string robotm_path = "/tmp/" + name + "_robot.json";
+
+    std::ofstream robot_cfg(robotm_path);
+    robot_cfg<<"{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0}}";
+    robot_cfg.close();
+
+    gdalwrap::gdal region;
+    region.set_size(4, 20, 20);
+    region.names = {"NO_3D_CLASS", "FLAT", "OBSTACLE", "ROUGH"};
+    region.bands[1].assign(20*20, 1);
+    for ( int i=2 ; i < 20 ; i++ ) {
+        region.bands[1][i+10*20] = 0.2 ;
+        region.bands[2][i+10*20] = 0.8 ;
+    }
+    region.save(region_path);
+
+    return weight_map(region_path, robotm_path);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE( adaptive )
+
+BOOST_AUTO_TEST_CASE( test_adaptive_astar )
+{
+    weight_map wm = make_wall_map("test_adaptive_astar");
+    nav_graph ng(wm);
+    point_xy_t goal = {15, 18};
+    adaptive_astar planner(ng.get_graph(), ng.get_closest_vertex(goal));
+
+    point_xy_t p1 = {15, 2};
+    path_t path = planner.search(ng.get_closest_vertex(p1));
+    size_t first_expanded = planner.get_expanded();
+    path_cost_util_t ref = ng.astar_search(points_t({p1}), points_t({goal}));
+    BOOST_CHECK_EQUAL( path.size(), ref.path.size() );
+    BOOST_CHECK_CLOSE( planner.get_cost(), ref.cost, 1e-4 );
+
+    // the robot moved along the path: same cost, far fewer expansions
+    for (size_t step = 3; step < 12; step += 3) {
+        point_xy_t now = path[step];
+        path_t next = planner.search(ng.get_closest_vertex(now));
+        ref = ng.astar_search(points_t({now}), points_t({goal}));
+        BOOST_CHECK_CLOSE( planner.get_cost(), ref.cost, 1e-4 );
+        BOOST_CHECK_EQUAL( next.size(), ref.path.size() );
+        BOOST_TEST_MESSAGE( "expanded: " << planner.get_expanded()
+                            << " (first search: " << first_expanded << ")" );
+        BOOST_CHECK( planner.get_expanded() < first_expanded );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_adaptive_astar_decrease )
+{
+    weight_map wm = make_wall_map("test_adaptive_astar_decrease");
+    nav_graph ng(wm);
+    graph_t g = ng.get_graph(); // mutable copy
+    point_xy_t goal = {15, 18};
+    vertex_t start = ng.get_closest_vertex(point_xy_t{15, 2});
+
+    adaptive_astar planner(g, ng.get_closest_vertex(goal));
+    planner.search(start);
+    double before = planner.get_cost();
+
+    // every edge gets 4 times cheaper
+    time_t later = std::time(0) + 10;
+    boost::graph_traits<graph_t>::edge_iterator ei, ei_end;
+    for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
+        g[*ei].weight /= 4;
+        g[*ei].t = later;
+    }
+    planner.search(start);
+    adaptive_astar fresh(g, ng.get_closest_vertex(goal));
+    fresh.search(start);
+    BOOST_CHECK_CLOSE( planner.get_cost(), fresh.get_cost(), 1e-4 );
+    BOOST_CHECK( planner.get_cost() < before );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
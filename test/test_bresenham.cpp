@@ -10,6 +10,9 @@
 #define BOOST_TEST_MODULE const_string test
 #include <boost/test/included/unit_test.hpp>
 
+#include <array>
+#include <vector>
+
 #include "gladys/bresenham.hpp"
 
 using namespace gladys;
@@ -46,4 +49,82 @@ BOOST_AUTO_TEST_CASE( test_bresenham )
     BOOST_CHECK_EQUAL( b , true );
 }
 
+BOOST_AUTO_TEST_CASE( test_bresenham_walk )
+{
+    // expected cells from (0, 0), one line per octant, then axes and diagonal
+    std::vector<std::vector<std::array<int, 2>>> lines = {
+        {{0,0},{1,0},{2,1},{3,1},{4,2},{5,2}},
+        {{0,0},{0,1},{1,2},{1,3},{2,4},{2,5}},
+        {{0,0},{0,1},{-1,2},{-1,3},{-2,4},{-2,5}},
+        {{0,0},{-1,0},{-2,1},{-3,1},{-4,2},{-5,2}},
+        {{0,0},{-1,0},{-2,-1},{-3,-1},{-4,-2},{-5,-2}},
+        {{0,0},{0,-1},{-1,-2},{-1,-3},{-2,-4},{-2,-5}},
+        {{0,0},{0,-1},{1,-2},{1,-3},{2,-4},{2,-5}},
+        {{0,0},{1,0},{2,-1},{3,-1},{4,-2},{5,-2}},
+        {{0,0},{1,0},{2,0},{3,0},{4,0}},
+        {{0,0},{0,-1},{0,-2},{0,-3},{0,-4}},
+        {{0,0},{1,1},{2,2},{3,3}},
+        {{0,0}},
+    };
+    for (const auto& line : lines) {
+        std::vector<std::array<int, 2>> cells;
+        bool b = gladys::bresenham_walk( 0, 0, line.back()[0], line.back()[1],
+                [&](int x, int y) -> bool {
+            cells.push_back( std::array<int, 2> {{ x, y }} );
+            return true;
+        });
+        BOOST_CHECK( b );
+        BOOST_CHECK( cells == line );
+    }
+
+    // stop at the first cell refused by the visitor
+    size_t n = 0;
+    bool b = gladys::bresenham_walk( 1, 1, 11, 5, [&](int x, int) -> bool {
+        n++;
+        return x < 5 ;
+    });
+    BOOST_CHECK_EQUAL( b, false );
+    BOOST_CHECK_EQUAL( n, 5 );
+}
+
+BOOST_AUTO_TEST_CASE( test_bresenham_line )
+{
+    for (int dx = -9; dx <= 9; dx++)
+    for (int dy = -9; dy <= 9; dy++) {
+        std::vector<std::array<long, 2>> cells;
+        gladys::bresenham_walk( 3, 4, 3 + dx, 4 + dy, [&](int x, int y) -> bool {
+            cells.push_back( std::array<long, 2> {{ x, y }} );
+            return true;
+        });
+        // step by step, and jumps of every length
+        for (size_t jump = 1; jump < cells.size(); jump++) {
+            gladys::bresenham_line line( 3, 4, 3 + dx, 4 + dy );
+            BOOST_CHECK_EQUAL( line.remaining() + 1, long(cells.size()) );
+            for (size_t i = 0; ; i += jump) {
+                BOOST_CHECK_EQUAL( line.x(), cells[i][0] );
+                BOOST_CHECK_EQUAL( line.y(), cells[i][1] );
+                if ( line.remaining() < long(jump) )
+                    break;
+                line.advance(jump);
+            }
+        }
+        // steps before leaving a box: the first cell out of it
+        for (size_t i = 0; i < cells.size(); i++) {
+            gladys::bresenham_line line( 3, 4, 3 + dx, 4 + dy );
+            line.advance(i);
+            long x0 = cells[i][0] - 1, y0 = cells[i][1] - 2;
+            long x1 = cells[i][0] + 2, y1 = cells[i][1] + 1;
+            size_t j = i;
+            while ( j < cells.size() and cells[j][0] >= x0 and cells[j][0] <= x1
+                                     and cells[j][1] >= y0 and cells[j][1] <= y1 )
+                j++;
+            long n = line.steps_in(x0, y0, x1, y1);
+            if ( j < cells.size() )
+                BOOST_CHECK_EQUAL( n, long(j - i) );
+            else
+                BOOST_CHECK( n > line.remaining() );
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -96,6 +96,17 @@ void main_test()
      */
     BOOST_CHECK_EQUAL(lru("first"), "tsrif"); 
     BOOST_CHECK_EQUAL(count_evaluations, 10); 
+
+    /* find and store do not evaluate, store keeps the first value */
+    std::string v;
+    BOOST_CHECK(lru.find("first", v));
+    BOOST_CHECK_EQUAL(v, "tsrif");
+    BOOST_CHECK(!lru.find("second", v));
+    lru.store("second", "computed");
+    lru.store("second", "again");
+    BOOST_CHECK(lru.find("second", v));
+    BOOST_CHECK_EQUAL(v, "computed");
+    BOOST_CHECK_EQUAL(count_evaluations, 10); 
 }
  
 BOOST_AUTO_TEST_CASE( test_cache_map )
@@ -12,6 +12,7 @@
 
 #include <string>
 #include <sstream>
+#include <fstream>
 
 #include "gdalwrap/gdal.hpp"
 #include "gladys/gladys.hpp"
@@ -20,6 +21,38 @@
 
 using namespace gladys;
 
+namespace {
+
+/** robot model and 9x9 region with an obstacle on the 6th row but for
+ * its first cell, saved under /tmp/test_dstar_<name>.tif */
+struct wall_region {
+    std::string region_path, robotm_path;
+
+    wall_region(const std::string& name) :
+        region_path("/tmp/test_dstar_" + name + ".tif"),
+        robotm_path("/tmp/robot.json") {
+        // create a robot model (JSON configuration file)
+        std::ofstream robot_cfg(robotm_path);
+        robot_cfg<<"{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0}}";
+        robot_cfg.close();
+
+        // create a region map (GeoTiff image)
+        gdalwrap::gdal region;
+        region.set_size(4, 9, 9);
+        // name bands
+        region.names = {"NO_3D_CLASS", "FLAT", "OBSTACLE", "ROUGH"};
+        // add an obstacle at the center of the map
+        region.bands[1].assign(9*9, 1);
+        for ( int i=1 ; i < 9 ; i++ ) {
+            region.bands[1][i+5*9] = 0.2 ;
+            region.bands[2][i+5*9] = 0.8 ;
+        }
+        region.save(region_path);
+    }
+};
+
+} // namespace
+
 BOOST_AUTO_TEST_SUITE( dstar )
 
 BOOST_AUTO_TEST_CASE( test_dstar )
@@ -82,4 +115,70 @@ BOOST_AUTO_TEST_CASE( test_dstar )
 
 }
 
+BOOST_AUTO_TEST_CASE( test_dstar_limits )
+{
+    wall_region world("limits");
+
+    weight_map wm(world.region_path, world.robotm_path);
+    nav_graph ng(wm);
+    vertex_t start = ng.get_closest_vertex(point_xy_t{1, 1});
+    vertex_t goal  = ng.get_closest_vertex(point_xy_t{5, 9});
+
+    dstar_search dense(ng.get_graph(), start, goal);
+    path_t expected = dense.get_path();
+
+    // sparse storage, no budget: same path, fewer stored vertices
+    dstar_search sparse(ng.get_graph(), start, goal, dstar_limits(true));
+    BOOST_CHECK( sparse.is_complete() );
+    BOOST_CHECK( sparse.get_path() == expected );
+    BOOST_TEST_MESSAGE( "touched: " << sparse.get_touched() << " / "
+                        << boost::num_vertices(ng.get_graph()) );
+    BOOST_CHECK( sparse.get_touched() < boost::num_vertices(ng.get_graph()) );
+
+    // tiny budget: best-effort path, then resume until complete
+    dstar_search bounded(ng.get_graph(), start, goal, dstar_limits(true, 5));
+    BOOST_CHECK( not bounded.is_complete() );
+    path_t partial = bounded.get_path();
+    BOOST_CHECK( partial.size() > 0 );
+    BOOST_CHECK_EQUAL( partial[0][0], expected[0][0] );
+    BOOST_CHECK_EQUAL( partial[0][1], expected[0][1] );
+
+    size_t calls = 0;
+    while (not bounded.is_complete() and calls++ < 1000)
+        bounded.replan(start);
+    BOOST_CHECK( bounded.is_complete() );
+    BOOST_CHECK_EQUAL( bounded.get_path().size(), expected.size() );
+}
+
+BOOST_AUTO_TEST_CASE( test_dstar_snapshot )
+{
+    wall_region world("snapshot");
+    std::string snapshot_path = "/tmp/test_dstar_snapshot.bin";
+
+    weight_map wm(world.region_path, world.robotm_path);
+    nav_graph ng(wm);
+    vertex_t start = ng.get_closest_vertex(point_xy_t{1, 1});
+    vertex_t goal  = ng.get_closest_vertex(point_xy_t{5, 9});
+
+    dstar_search dstar(ng.get_graph(), start, goal);
+    dstar.save(snapshot_path);
+
+    // restore in another instance (here with sparse storage)
+    dstar_search restored(ng.get_graph(), snapshot_path, dstar_limits(true));
+    BOOST_CHECK( restored.get_path() == dstar.get_path() );
+
+    path_t path = dstar.get_path();
+    vertex_t now = ng.get_closest_vertex(path[2]);
+    dstar.replan(now);
+    restored.replan(now);
+    BOOST_CHECK( restored.get_path() == dstar.get_path() );
+
+    // a snapshot is bound to its graph
+    weight_map wm_small(world.region_path, world.robotm_path);
+    wm_small.get_map().bands[0].assign(9*9, std::numeric_limits<float>::infinity());
+    nav_graph ng_small(wm_small);
+    BOOST_CHECK_THROW( dstar_search(ng_small.get_graph(), snapshot_path),
+                       std::runtime_error );
+}
+
 BOOST_AUTO_TEST_SUITE_END();
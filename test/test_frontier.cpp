@@ -101,6 +101,16 @@ BOOST_AUTO_TEST_CASE( test_frontier )
     BOOST_TEST_MESSAGE( "Nbr of frontier points : c = " << c );
     BOOST_CHECK_EQUAL( c , 18 );
 
+    // same map off the integer grid: the frontier points still are the
+    // rounded seed moved by whole cells
+    region.set_transform(0.25, 0.25, 1, 1);
+    region.save(region_path);
+    weight_map wm_offset ( region_path, robotm_path ) ;
+    nav_graph ng_offset ( wm_offset ) ;
+    frontier_detector fd_offset ( ng_offset, -5, -5, 20, 20 ) ;
+    fd_offset.compute_frontiers( r_pos, yaw ) ;
+    BOOST_CHECK( fd_offset.get_frontiers() == frontiers );
+
 }
 
 BOOST_AUTO_TEST_SUITE_END();
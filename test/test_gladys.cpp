@@ -12,11 +12,55 @@
 
 #include <string>
 #include <sstream>
+#include <fstream>
 
 #include "gdalwrap/gdal.hpp"
 #include "gladys/gladys.hpp"
 #include "gladys/nav_graph.hpp"
 
+namespace {
+
+/** files of a flat 40x40 map split by a wall at x = 20, for a robot with
+ * a sensor and an antenna (at 'antenna_x' from the robot)
+ */
+struct wall_world {
+    static const size_t size = 40;
+    std::string region_path, dtm_path, robotm_path;
+
+    wall_world(const std::string& name, double antenna_x) :
+        region_path("/tmp/test_gladys_" + name + "_region.tif"),
+        dtm_path("/tmp/test_gladys_" + name + "_dtm.tif"),
+        robotm_path("/tmp/test_gladys_" + name + "_robot.json") {
+        std::ofstream robot_cfg(robotm_path);
+        robot_cfg
+            << "{"
+                << "\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0},"
+                << "\"sensor\":{\"range\":20.0,\"fov\":6.28,"
+                    <<   "\"pose\":{\"x\":0.0,\"y\":0.0,\"z\":0.5,\"t\":0.0}},"
+                << "\"antenna\":{\"range\":12.0,\"fov\":6.28,"
+                    <<   "\"pose\":{\"x\":" << antenna_x
+                    <<   ",\"y\":0.0,\"z\":1.0,\"t\":0.0}}"
+            << "}" ;
+        robot_cfg.close();
+
+        gdalwrap::gdal region;
+        region.set_size(4, size, size);
+        region.names = {"NO_3D_CLASS", "FLAT", "OBSTACLE", "ROUGH"};
+        region.bands[1].assign(size * size, 1);
+        region.save(region_path);
+
+        gdalwrap::gdal dtm;
+        dtm.set_size(2, size, size);
+        dtm.names = {"Z_MAX", "N_POINTS"};
+        dtm.bands[1].assign(size * size, 3);
+        for (size_t y = 0; y < size; y++)
+            dtm.bands[0][20 + y * size] = 5;
+        dtm.save(dtm_path);
+    }
+};
+
+} // namespace
+
 BOOST_AUTO_TEST_SUITE( gladys )
 
 BOOST_AUTO_TEST_CASE( test_raster_to_graph )
@@ -132,5 +176,203 @@ BOOST_AUTO_TEST_CASE( test_raster_to_graph )
     BOOST_CHECK_EQUAL(b, false);
 }
 
+BOOST_AUTO_TEST_CASE( test_lazy_unknown_edges )
+{
+    std::string region_path = "/tmp/test_gladys_lazy_unknown.tif";
+    std::string robotm_path = "/tmp/robot.json";
+
+    std::ofstream robot_cfg(robotm_path);
+    robot_cfg<<"{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0}}";
+    robot_cfg.close();
+
+    // mostly unknown map, known corridor on the top rows, wall with a gap
+    gdalwrap::gdal region;
+    region.set_size(4, 20, 20);
+    region.names = {"NO_3D_CLASS", "FLAT", "OBSTACLE", "ROUGH"};
+    region.bands[0].assign(20*20, 1);
+    for ( int i=0 ; i < 20*3 ; i++ ) {
+        region.bands[0][i] = 0 ;
+        region.bands[1][i] = 1 ;
+    }
+    for ( int i=0 ; i < 18 ; i++ ) {
+        region.bands[0][i+10*20] = 0 ;
+        region.bands[2][i+10*20] = 0.8 ;
+    }
+    region.save(region_path);
+
+    weight_map wm(region_path, robotm_path);
+    nav_graph eager(wm);
+    nav_graph lazy(wm, true);
+    const graph_t& partial = lazy.get_partial_graph();
+    BOOST_TEST_MESSAGE( "vertices: eager " << boost::num_vertices(eager.get_graph())
+                        << ", lazy " << boost::num_vertices(partial) );
+    BOOST_TEST_MESSAGE( "edges: eager " << boost::num_edges(eager.get_graph())
+                        << ", lazy " << boost::num_edges(partial) );
+    BOOST_CHECK( boost::num_vertices(partial) * 4 <
+                 boost::num_vertices(eager.get_graph()) );
+    BOOST_CHECK( boost::num_edges(partial) * 4 <
+                 boost::num_edges(eager.get_graph()) );
+
+    point_xy_t p1 = {2, 1};
+    point_xy_t p2 = {3, 17}; // in the unknown, behind the wall
+    points_t goals = {p1, p2, point_xy_t{15, 1}};
+
+    // the const searches and get_graph (dstar_search, adaptive_astar) reject it
+    const nav_graph& const_lazy = lazy;
+    BOOST_CHECK( !lazy.is_expanded() );
+    BOOST_CHECK_THROW( const_lazy.astar_search(p1, p2), std::logic_error );
+    BOOST_CHECK_THROW( lazy.get_graph(), std::logic_error );
+
+    for (const auto& goal : goals) {
+        path_cost_util_t e = eager.astar_search(points_t({p1}), points_t({goal}));
+        path_cost_util_t l = lazy.astar_search(points_t({p1}), points_t({goal}));
+        // the lazy search sums its costs in double, boost::astar_search in float
+        BOOST_CHECK_CLOSE( e.cost, l.cost, 1e-4 );
+        BOOST_CHECK_EQUAL( e.path.size(), l.path.size() );
+    }
+    // the searches only built the cells they reached
+    BOOST_CHECK( !lazy.is_expanded() );
+    BOOST_CHECK( boost::num_vertices(partial) <
+                 boost::num_vertices(eager.get_graph()) );
+
+    std::vector<double> ce = eager.single_source_all_costs(p1, goals);
+    std::vector<double> cl = lazy.single_source_all_costs(p1, goals);
+    BOOST_CHECK( ce == cl );
+
+    // single_source_all_costs built them all
+    BOOST_CHECK( lazy.is_expanded() );
+    BOOST_CHECK_EQUAL( boost::num_vertices(lazy.get_graph()),
+                       boost::num_vertices(eager.get_graph()) );
+    BOOST_CHECK_EQUAL( boost::num_edges(lazy.get_graph()),
+                       boost::num_edges(eager.get_graph()) );
+    BOOST_CHECK_EQUAL( const_lazy.astar_search(p1, p2).size(),
+                       eager.astar_search(p1, p2).size() );
+}
+
+BOOST_AUTO_TEST_CASE( test_communication_links )
+{
+    // the antenna is off the robot center: can_communicate is one way
+    wall_world world("comm", 0.3);
+    const size_t size = wall_world::size;
+
+    gladys g(world.region_path, world.dtm_path, world.robotm_path);
+    std::srand(48);
+    points_t locs;
+    while (locs.size() < 60) {
+        point_xy_t p = {double(std::rand() % size), double(std::rand() % size)};
+        if (p[0] != 20) // not on the wall, it sees both sides
+            locs.push_back(p);
+    }
+    locs.push_back(locs[0]); // twice the same point
+
+    comm_links_t comm = g.communication_links(locs);
+    BOOST_REQUIRE_EQUAL( comm.size, locs.size() );
+    // the points are cell centers: the same links, cached by cell pair
+    g.enable_visibility_cache(1000);
+    size_t n_links = 0, n_one_way = 0, mismatch = 0;
+    for (size_t i = 0; i < locs.size(); i++)
+    for (size_t j = i + 1; j < locs.size(); j++) {
+        bool linked = comm.links[i * locs.size() + j];
+        // the antenna is at the first point: linked if both ways
+        bool ij = g.can_communicate(locs[i], locs[j]);
+        bool ji = g.can_communicate(locs[j], locs[i]);
+        if (linked != (ij and ji) or
+            linked != comm.links[j * locs.size() + i])
+            mismatch++;
+        if (linked and comm.component[i] != comm.component[j])
+            mismatch++;
+        if (linked != g.can_communicate_cell(locs[i], locs[j]) or
+            linked != g.can_communicate_cell(locs[j], locs[i]))
+            mismatch++;
+        n_links += linked;
+        n_one_way += ij != ji;
+    }
+    BOOST_TEST_MESSAGE( "communication: " << n_links << " links, "
+                        << n_one_way << " one way, "
+                        << comm.n_components << " components" );
+    BOOST_CHECK( n_links > 0 );
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+    BOOST_CHECK( comm.n_components > 1 );
+    // a component is connected: flood it from its first point
+    for (size_t c = 0; c < comm.n_components; c++) {
+        std::vector<size_t> stack, members;
+        std::vector<bool> seen(locs.size(), false);
+        for (size_t i = 0; i < locs.size(); i++)
+            if (comm.component[i] == c) {
+                members.push_back(i);
+                if (stack.empty()) {
+                    stack.push_back(i);
+                    seen[i] = true;
+                }
+            }
+        size_t reached = 0;
+        while (!stack.empty()) {
+            size_t i = stack.back();
+            stack.pop_back();
+            reached++;
+            for (size_t j = 0; j < locs.size(); j++)
+                if (comm.links[i * locs.size() + j] and !seen[j]) {
+                    seen[j] = true;
+                    stack.push_back(j);
+                }
+        }
+        BOOST_CHECK_EQUAL( reached, members.size() );
+    }
+    BOOST_CHECK_EQUAL( g.communication_links(points_t()).n_components, 0 );
+
+    // the same links with horizons, tested both ways together
+    g.build_horizons();
+    BOOST_CHECK( g.communication_links(locs).links == comm.links );
+
+    // an antenna of no range, centered: no link, each point on its own
+    wall_world deaf("comm_deaf", 0);
+    std::ofstream robot_cfg(deaf.robotm_path);
+    robot_cfg
+        << "{"
+            << "\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0},"
+            << "\"sensor\":{\"range\":20.0,\"fov\":6.28,"
+                <<   "\"pose\":{\"x\":0.0,\"y\":0.0,\"z\":0.5,\"t\":0.0}},"
+            << "\"antenna\":{\"range\":0.0,\"fov\":6.28,"
+                <<   "\"pose\":{\"x\":0.0,\"y\":0.0,\"z\":1.0,\"t\":0.0}}"
+        << "}" ;
+    robot_cfg.close();
+    gladys g_deaf(deaf.region_path, deaf.dtm_path, deaf.robotm_path);
+    comm_links_t none = g_deaf.communication_links(locs);
+    BOOST_CHECK_EQUAL( none.n_components, locs.size() );
+    BOOST_CHECK_EQUAL( std::count(none.links.begin(), none.links.end(), true), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_visibility_link )
+{
+    wall_world world("link", 0);
+    const size_t size = wall_world::size;
+
+    gladys g(world.region_path, world.dtm_path, world.robotm_path);
+    points_t left = {{5, 5}, {8, 30}, {15, 18}};
+    points_t right = {{25, 5}, {33, 30}, {38, 18}};
+    BOOST_CHECK( !g.test_visibility_link(left, right, 0) );
+    BOOST_CHECK( g.test_visibility_link(left, left, 0) );
+    BOOST_CHECK( !g.test_visibility_link(left, points_t(), 0) );
+
+    // quality 1 - d / range: about 0.5 for (5, 5) to (15, 5)
+    points_t near = {{15, 5}};
+    BOOST_CHECK( g.test_visibility_link({{5, 5}}, near, 0.4) );
+    BOOST_CHECK( !g.test_visibility_link({{5, 5}}, near, 0.6) );
+
+    // same as testing every pair
+    std::srand(49);
+    for (size_t n = 0; n < 20; n++) {
+        points_t llocA, llocB;
+        for (size_t i = 0; i < 4; i++) {
+            llocA.push_back({double(std::rand() % size), double(std::rand() % size)});
+            llocB.push_back({double(std::rand() % size), double(std::rand() % size)});
+        }
+        bool expected = false;
+        for (const point_xy_t& a : llocA)
+            for (const point_xy_t& b : llocB)
+                expected = expected or g.is_visible(a, b);
+        BOOST_CHECK_EQUAL( g.test_visibility_link(llocA, llocB, 0), expected );
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END();
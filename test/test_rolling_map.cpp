@@ -0,0 +1,120 @@
+/*
+ * test_rolling_map.cpp
+ *
+ * Test the Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-19
+ * license: BSD
+ */
+#define BOOST_TEST_MODULE const_string test
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include <limits>
+
+#include "gdalwrap/gdal.hpp"
+#include "gladys/weight_map.hpp"
+#include "gladys/nav_graph.hpp"
+#include "gladys/rolling_map.hpp"
+
+BOOST_AUTO_TEST_SUITE( rolling_map )
+
+// global map: random weights, some obstacles and unknown cells
+static gdalwrap::gdal make_global(size_t width, size_t height) {
+    gdalwrap::gdal global;
+    global.set_size(1, width, height);
+    global.names[0] = "WEIGHT";
+    global.set_transform(1000, 2000, 0.5, -0.5);
+    std::srand(36);
+    for (auto& weight : global.bands[0]) {
+        int r = std::rand() % 20;
+        if (r == 0)
+            weight = std::numeric_limits<float>::infinity();
+        else if (r == 1)
+            weight = -1;
+        else
+            weight = 1 + (std::rand() % 100) / 10.0;
+    }
+    return global;
+}
+
+// crop of the global weight map, to build a nav_graph of the window
+static gdalwrap::gdal crop(const gdalwrap::gdal& global, long x0, long y0,
+                           size_t width, size_t height) {
+    gdalwrap::gdal window;
+    window.set_size(1, width, height);
+    window.names[0] = "WEIGHT";
+    window.set_transform(global.get_utm_pose_x() + x0 * global.get_scale_x(),
+                         global.get_utm_pose_y() + y0 * global.get_scale_y(),
+                         global.get_scale_x(), global.get_scale_y());
+    for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+        long gx = x0 + x, gy = y0 + y;
+        if (gx < 0 or gy < 0 or gx >= long(global.get_width())
+                   or gy >= long(global.get_height()))
+            window.bands[0][x + y * width] = std::numeric_limits<float>::infinity();
+        else
+            window.bands[0][x + y * width] =
+                global.bands[0][gx + gy * global.get_width()];
+    }
+    return window;
+}
+
+BOOST_AUTO_TEST_CASE( test_rolling_map_scroll )
+{
+    const size_t width = 60, height = 50, win_w = 15, win_h = 11;
+    gdalwrap::gdal global = make_global(width, height);
+    gladys::weight_map wm(global);
+
+    gladys::point_xy_t center = global.point_pix2utm(20, 20);
+    gladys::rolling_map rm(wm, win_w, win_h, center);
+    size_t n_vertices = boost::num_vertices(rm.get_graph());
+    size_t n_edges = boost::num_edges(rm.get_graph());
+
+    // moves: small steps, diagonal, back, off the map, a jump
+    std::vector<std::array<double, 2>> moves = {
+        {{21, 20}}, {{23, 21}}, {{22, 24}}, {{18, 19}}, {{3, 2}},
+        {{-4, 1}}, {{57, 47}}, {{30, 25}}, {{31, 25}} };
+    for (const auto& move : moves) {
+        center = global.point_pix2utm(move[0], move[1]);
+        rm.recenter(center);
+        // nothing reallocated
+        BOOST_CHECK_EQUAL( boost::num_vertices(rm.get_graph()), n_vertices );
+        BOOST_CHECK_EQUAL( boost::num_edges(rm.get_graph()), n_edges );
+        long x0 = rm.get_origin_x(), y0 = rm.get_origin_y();
+        BOOST_CHECK_EQUAL( x0, long(move[0]) - long(win_w / 2) );
+        BOOST_CHECK_EQUAL( y0, long(move[1]) - long(win_h / 2) );
+
+        // same weights as the global map, in the window
+        gdalwrap::gdal window = crop(global, x0, y0, win_w, win_h);
+        size_t mismatch = 0;
+        for (size_t y = 0; y < win_h; y++)
+        for (size_t x = 0; x < win_w; x++) {
+            float expected = window.bands[0][x + y * win_w];
+            if (expected <= 0)
+                expected = 100;
+            if (rm.get_weight(x0 + x, y0 + y) != expected)
+                mismatch++;
+        }
+        BOOST_CHECK_EQUAL( mismatch, 0 );
+
+        // same costs as a nav_graph of the window
+        gladys::weight_map wm_window(window);
+        gladys::nav_graph ng(wm_window);
+        gladys::point_xy_t start = window.point_pix2utm(1, 1);
+        gladys::point_xy_t goal = window.point_pix2utm(win_w - 2, win_h - 2);
+        gladys::path_cost_util_t expected = ng.astar_search(
+            gladys::points_t({start}), gladys::points_t({goal}));
+        gladys::path_cost_util_t result = rm.astar_search(start, goal);
+        BOOST_TEST_MESSAGE( "move " << move[0] << "," << move[1] << " cost " << result.cost );
+        BOOST_CHECK_EQUAL( result.path.empty(), expected.path.empty() );
+        if (not expected.path.empty()) {
+            BOOST_CHECK_CLOSE( result.cost, expected.cost, 1e-4 );
+            BOOST_CHECK( result.path.front() == expected.path.front() );
+            BOOST_CHECK( result.path.back() == expected.path.back() );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -12,30 +12,20 @@
 
 #include <string>
 #include <sstream>
+#include <cmath>
 
 #include "gdalwrap/gdal.hpp"
 #include "gladys/visibility_map.hpp"
+#include "gladys/bresenham.hpp"
+#include "gladys/los_kernel.hpp"
+#include "gladys/packed_dtm.hpp"
 
-BOOST_AUTO_TEST_SUITE( visibility )
-
-BOOST_AUTO_TEST_CASE( test_visibility_map )
-{
-    std::string dtm_path = "/tmp/test_visibility.tif";
-    std::string vm_path = "/tmp/test_visibility_map.tif";
-    std::string robotm_path = "/tmp/robot.json";
-
-    // create a robot model (JSON configuration file)
-    std::ofstream robot_cfg(robotm_path);
-    robot_cfg
-        << "{"
-            << "\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0},"
-            << "\"sensor\":{\"range\":20.0,\"fov\":6.28,"
-                <<   "\"pose\":{\"x\":0.1,\"y\":0.2,\"z\":0.7,\"t\":0.0}"
-            << "}"
-        << "}" ;
-    robot_cfg.close();
+namespace {
 
-    // create a dtm map (GeoTiff image)
+/** 9x9 cells of 1 m, a small wall in the middle (x = 5), a band of
+ * never-observed cells (x = 3) and a few special points
+ */
+gdalwrap::gdal make_wall() {
     gdalwrap::gdal dtm;
     dtm.set_size(2, 9, 9);
     // add a small wall in the middle of the map
@@ -54,8 +44,52 @@ BOOST_AUTO_TEST_CASE( test_visibility_map )
         dtm.get_band("N_POINTS")[ 3 + i*9 ] = 0.0;
     // one special point to observe
     dtm.get_band("N_POINTS")[ 8 + 5*9 ] = 0.0;
+    return dtm;
+}
 
-    dtm.save(dtm_path);
+/** gentle hills of 90x70 cells of 0.5 m, with a spike every 'spikes'
+ * cells, and unknown cells (one in 19, scattered) if 'unknown'
+ */
+gdalwrap::gdal make_hills(size_t spikes, bool unknown) {
+    const size_t width = 90, height = 70;
+    gdalwrap::gdal dtm;
+    dtm.set_size(2, width, height);
+    dtm.names = {"Z_MAX", "N_POINTS"};
+    dtm.set_transform(0, 0, 0.5, 0.5);
+    for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+        size_t pos = x + y * width;
+        dtm.bands[0][pos] = 0.4 * std::sin(x * 0.1) * std::cos(y * 0.08);
+        if (pos % spikes == 0)
+            dtm.bands[0][pos] += 4;
+        dtm.bands[1][pos] = (unknown and pos * 7919 % 19 == 0) ? 0 : 3;
+    }
+    return dtm;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE( visibility )
+
+BOOST_AUTO_TEST_CASE( test_visibility_map )
+{
+    std::string dtm_path = "/tmp/test_visibility.tif";
+    std::string vm_path = "/tmp/test_visibility_map.tif";
+    std::string robotm_path = "/tmp/robot.json";
+
+    // create a robot model (JSON configuration file)
+    std::ofstream robot_cfg(robotm_path);
+    robot_cfg
+        << "{"
+            << "\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0},"
+            << "\"sensor\":{\"range\":20.0,\"fov\":6.28,"
+                <<   "\"pose\":{\"x\":0.1,\"y\":0.2,\"z\":0.7,\"t\":0.0}"
+            << "}"
+        << "}" ;
+    robot_cfg.close();
+
+    // create a dtm map (GeoTiff image)
+    make_wall().save(dtm_path);
 
     //// create a visibility map from the dtm
     gladys::visibility_map vm;
@@ -86,6 +120,690 @@ BOOST_AUTO_TEST_CASE( test_visibility_map )
     BOOST_TEST_MESSAGE( "t2 visible from s above the walls ? " + std::to_string(b) );
     BOOST_CHECK_EQUAL( b, true );
 
+    // a sensor below the ground of its own cell: the cell (d = 0) hides
+    // every target, a*0 + z - zs > EPS
+    gladys::point_xyz_t sLow = {0, 5, -0.2};
+    gladys::point_xyz_t t1Low = {8, 0, 0};
+    BOOST_CHECK_EQUAL( vm.is_visible( sLow, t1Low ), false );
+
+    // a higher wall, raised through the deprecated mutable get_dtm
+    gdalwrap::raster& z_max = vm.get_dtm().get_band("Z_MAX");
+    for (int i=0 ; i<9 ; i++ )
+        z_max[ 2 + i*9 ] = 5;
+    BOOST_CHECK_EQUAL( vm.is_visible( s, t1 ), false );
+
+    // without Z_MAX, the dtm loads and the line-of-sight tests throw
+    gdalwrap::gdal no_z_max = make_wall();
+    no_z_max.names[0] = "Z_MEAN";
+    no_z_max.save(dtm_path);
+    vm.load(dtm_path, robotm_path);
+    BOOST_CHECK_THROW( vm.is_visible( s, t1 ), std::exception );
+}
+
+BOOST_AUTO_TEST_CASE( test_visibility_map_streamed_mapped )
+{
+    std::string dtm_path = "/tmp/test_visibility_streamed.tif";
+    std::string robotm_path = "/tmp/robot.json";
+
+    std::ofstream robot_cfg(robotm_path);
+    robot_cfg
+        << "{"
+            << "\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0},"
+            << "\"sensor\":{\"range\":20.0,\"fov\":6.28,"
+                <<   "\"pose\":{\"x\":0.1,\"y\":0.2,\"z\":0.7,\"t\":0.0}"
+            << "}"
+        << "}" ;
+    robot_cfg.close();
+
+    // a band not needed for visibility, and more rows than a block
+    const size_t width = 23, height = 150;
+    gdalwrap::gdal dtm;
+    dtm.set_size(3, width, height);
+    dtm.names = {"Z_MEAN", "N_POINTS", "Z_MAX"};
+    for (size_t pos = 0; pos < width * height; pos++) {
+        dtm.bands[0][pos] = 7;
+        dtm.bands[1][pos] = pos % 11 ? 3 : 0;
+        dtm.bands[2][pos] = (pos * 7919 % 13) * 0.1;
+    }
+    dtm.save(dtm_path);
+
+    gladys::visibility_map vm, vm_streamed;
+    vm.load(dtm_path, robotm_path);
+    vm_streamed.load_streamed(dtm_path, robotm_path);
+
+    BOOST_CHECK_EQUAL( vm_streamed.get_dtm().bands.size(), 2 );
+    BOOST_CHECK_EQUAL( vm_streamed.get_width(), width );
+    BOOST_CHECK_EQUAL( vm_streamed.get_height(), height );
+    BOOST_CHECK( vm_streamed.get_heightmap() == vm.get_heightmap() );
+    BOOST_CHECK( vm_streamed.get_npointsmap() == vm.get_npointsmap() );
+
+    gladys::point_xy_t s = {3, 4};
+    for (size_t y = 0; y < height; y += 7)
+    for (size_t x = 0; x < width; x += 5) {
+        gladys::point_xy_t t = {double(x), double(y)};
+        BOOST_CHECK_EQUAL( vm_streamed.is_visible(s, t), vm.is_visible(s, t) );
+    }
+
+    // memory-mapped tiled bands
+    std::string tiles_path = "/tmp/test_visibility_mapped.tiles";
+    vm.save_mapped(tiles_path);
+    gladys::visibility_map vm_mapped;
+    vm_mapped.load_mapped(tiles_path, robotm_path);
+    BOOST_CHECK_EQUAL( vm_mapped.get_width(), width );
+    BOOST_CHECK_EQUAL( vm_mapped.get_height(), height );
+    BOOST_CHECK_THROW( vm_mapped.get_heightmap(), std::runtime_error );
+    BOOST_CHECK_THROW( vm_mapped.set_cell(0, 0, 1, 3), std::runtime_error );
+    size_t mismatch = 0;
+    for (size_t y = 0; y < height; y += 3)
+    for (size_t x = 0; x < width; x++) {
+        gladys::point_xy_t t = {double(x), double(y)};
+        if (vm_mapped.is_visible(s, t) != vm.is_visible(s, t))
+            mismatch++;
+    }
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+
+    // Z_MAX overviews, the same from resident or mapped bands
+    const gladys::raster_pyramid& pyramid = vm.get_pyramid();
+    BOOST_REQUIRE_EQUAL( pyramid.size(), 8 );
+    const gladys::pyramid_level& top = pyramid.get_level(8);
+    BOOST_CHECK_EQUAL( top.width * top.height, 1 );
+    BOOST_CHECK_CLOSE( top.max[0], 1.2, 1e-4 );
+    BOOST_CHECK_EQUAL( top.min[0], 0 );
+    for (size_t level = 1; level <= pyramid.size(); level++) {
+        BOOST_CHECK( vm_mapped.get_pyramid().get_level(level).max ==
+                     pyramid.get_level(level).max );
+        BOOST_CHECK( vm_mapped.get_pyramid().get_level(level).mean ==
+                     pyramid.get_level(level).mean );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_viewshed )
+{
+    std::string dtm_path = "/tmp/test_viewshed.tif";
+    std::string robotm_path = "/tmp/robot_viewshed.json";
+
+    std::ofstream robot_cfg(robotm_path);
+    robot_cfg
+        << "{"
+            << "\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0},"
+            << "\"sensor\":{\"range\":25.0,\"fov\":6.28,"
+                <<   "\"pose\":{\"x\":0.0,\"y\":0.0,\"z\":1.5,\"t\":0.0}"
+            << "}"
+        << "}" ;
+    robot_cfg.close();
+
+    // rolling terrain with a few walls and holes of unknown cells
+    const size_t width = 61, height = 47;
+    gdalwrap::gdal dtm;
+    dtm.set_size(2, width, height);
+    dtm.names = {"Z_MAX", "N_POINTS"};
+    for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+        size_t pos = x + y * width;
+        dtm.bands[0][pos] = std::sin(x * 0.3) + std::cos(y * 0.2);
+        if (x == 40 and y > 10 and y < 30)
+            dtm.bands[0][pos] = 4;
+        dtm.bands[1][pos] = (pos * 7919 % 17) ? 3 : 0;
+    }
+    dtm.save(dtm_path);
+
+    gladys::visibility_map vm;
+    vm.load(dtm_path, robotm_path);
+    gladys::point_xy_t s = {25, 20};
+    gdalwrap::raster visible = vm.viewshed(s);
+    BOOST_REQUIRE_EQUAL( visible.size(), width * height );
+
+    size_t n_visible = 0, n_in_range = 0, mismatch = 0;
+    for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+        gladys::point_xy_t t = {double(x), double(y)};
+        bool expected = vm.is_sensor_visible(s, t);
+        bool got = visible[x + y * width] > 0;
+        if (expected != got)
+            mismatch++;
+        if (got)
+            n_visible++;
+        if (gladys::distance(s, t) < 25)
+            n_in_range++;
+    }
+    BOOST_CHECK( n_visible > 0 );
+    BOOST_CHECK( n_visible < n_in_range );
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+    // next to the wall, and at the map borders
+    for (const gladys::point_xy_t& s2 : gladys::points_t{{38, 20}, {0, 0},
+                                                       {60, 46}, {3, 30}}) {
+        gdalwrap::raster visible2 = vm.viewshed(s2);
+        size_t mismatch2 = 0;
+        for (size_t y = 0; y < height; y++)
+        for (size_t x = 0; x < width; x++) {
+            gladys::point_xy_t t = {double(x), double(y)};
+            if (vm.is_sensor_visible(s2, t) != (visible2[x + y * width] > 0))
+                mismatch2++;
+        }
+        BOOST_CHECK_EQUAL( mismatch2, 0 );
+    }
+
+    // rays and direct lines only differ close to occluder edges
+    gdalwrap::raster approx = vm.viewshed_approx(s);
+    BOOST_REQUIRE_EQUAL( approx.size(), width * height );
+    size_t approx_mismatch = 0;
+    for (size_t i = 0; i < approx.size(); i++)
+        approx_mismatch += approx[i] != visible[i];
+    BOOST_TEST_MESSAGE( "viewshed " << n_visible << " visible, "
+                        << approx_mismatch << " approximate mismatches" );
+    BOOST_CHECK( approx_mismatch < n_in_range / 50 );
+    // batch of targets, with duplicates: same as the serial loop
+    gladys::points_t targets;
+    for (size_t i = 0; i < 500; i++)
+        targets.push_back({double(i * 37 % width), double(i * 53 % height)});
+    targets.push_back(targets[3]);
+    targets.push_back(s);
+    std::vector<bool> batch = vm.is_sensor_visible(s, targets);
+    BOOST_REQUIRE_EQUAL( batch.size(), targets.size() );
+    size_t batch_mismatch = 0;
+    for (size_t i = 0; i < targets.size(); i++)
+        if (batch[i] != vm.is_sensor_visible(s, targets[i]))
+            batch_mismatch++;
+    BOOST_CHECK_EQUAL( batch_mismatch, 0 );
+
+    // nothing beyond range, nor behind the wall
+    BOOST_CHECK_EQUAL( visible[0], 0 );
+    BOOST_CHECK_EQUAL( visible[55 + 20 * width], 0 );
+}
+
+/** line of sight walking every cell, as is_visible without the pyramid */
+static bool reference_is_visible(const gladys::visibility_map& vm,
+        const gladys::point_xyz_t& s, const gladys::point_xyz_t& t) {
+    const gdalwrap::raster& z = vm.get_heightmap();
+    const gdalwrap::raster& n = vm.get_npointsmap();
+    gladys::point_xy_t s2 = {s[0], s[1]}, t2 = {t[0], t[1]};
+    double d0 = gladys::distance(s2, t2);
+    if (d0 < 1.0 + 0.05) // robot radius
+        return true;
+    if (n[vm.index(s2)] < 0.95 or n[vm.index(t2)] < 0.95)
+        return false;
+    double zs = s[2] + z[vm.index(s2)], zt = t[2] + z[vm.index(t2)];
+    double a = (zs - zt) / d0;
+    for (const auto& p : gladys::bresenham(s2, t2)) {
+        size_t idx = vm.index(p);
+        double d = gladys::distance(s2, p);
+        if (n[idx] < 0.95)
+            continue;
+        if (a * d + z[idx] - zs > 0.05)
+            return false;
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE( test_visibility_threshold )
+{
+    std::string dtm_path = "/tmp/test_visibility_threshold.tif";
+    std::string robotm_path = "/tmp/robot.json";
+    make_wall().save(dtm_path);
+    gladys::visibility_map vm(dtm_path, robotm_path);
+
+    // from (0, 5) to (7, 5), the wall (x = 5) is on the EPS threshold,
+    // a*5 + 1.3 - zs = EPS, for a sensor about 2.525 m above its cell:
+    // the answers flip there, as the formula rounds
+    size_t n_visible = 0, mismatch = 0;
+    gladys::point_xyz_t s = {0, 5, 2.525}, t = {7, 5, 0};
+    for (double step : {1e-3, 1e-15}) {
+        for (int k = -50; k <= 50; k++) {
+            s[2] = 2.525 + k * step;
+            bool expected = reference_is_visible(vm, s, t);
+            mismatch += vm.is_visible(s, t) != expected;
+            n_visible += expected;
+        }
+    }
+    BOOST_CHECK( n_visible > 0 and n_visible < 202 );
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+    // well below and above the threshold
+    s[2] = 2.4;
+    BOOST_CHECK_EQUAL( vm.is_visible(s, t), false );
+    s[2] = 2.7;
+    BOOST_CHECK_EQUAL( vm.is_visible(s, t), true );
+}
+
+BOOST_AUTO_TEST_CASE( test_visibility_scaled_offset )
+{
+    std::string dtm_path = "/tmp/test_visibility_scaled.tif";
+    std::string robotm_path = "/tmp/robot.json";
+
+    // cells of 0.5 m, pixel (0, 0) centered on custom (0.25, 0.25), a one
+    // cell wide wall at column 21
+    const size_t width = 41, height = 11, wall = 21;
+    gdalwrap::gdal dtm;
+    dtm.set_size(2, width, height);
+    dtm.names = {"Z_MAX", "N_POINTS"};
+    dtm.set_transform(100.25, 50.25, 0.5, 0.5);
+    dtm.set_custom_origin(100, 50);
+    dtm.bands[1].assign(width * height, 3);
+    for (size_t y = 0; y < height; y++)
+        dtm.bands[0][wall + y * width] = 5;
+    dtm.save(dtm_path);
+    gladys::visibility_map vm(dtm_path, robotm_path);
+
+    // centers of the cells (2, 5) and (38, 5)
+    gladys::point_xy_t s = {1.25, 2.75}, t = {19.25, 2.75};
+    gladys::pixel_t ps = vm.pixel(s), pt = vm.pixel(t);
+    BOOST_REQUIRE_EQUAL( ps[0], 2 );
+    BOOST_REQUIRE_EQUAL( pt[0], 38 );
+
+    // the line is walked on the cells of the map, every column between
+    // the cells of s and t is tested once
+    std::vector<size_t> columns;
+    gladys::bresenham_walk(ps[0], ps[1], pt[0], pt[1], [&](int x, int) {
+        columns.push_back(x);
+        return true;
+    });
+    BOOST_REQUIRE_EQUAL( columns.size(), 37 );
+    for (size_t i = 0; i < columns.size(); i++)
+        BOOST_CHECK_EQUAL( columns[i], 2 + i );
+
+    // bresenham(s, t), the world coordinates cast to int that is_visible
+    // used to walk, tests one column in two on this map and misses the wall
+    size_t old_wall_hits = 0;
+    for (const auto& p : gladys::bresenham(s, t))
+        old_wall_hits += vm.index(p) % width == wall;
+    BOOST_CHECK_EQUAL( old_wall_hits, 0 );
+    BOOST_CHECK_EQUAL( vm.is_visible(s, t), false );
+    BOOST_CHECK_EQUAL( vm.is_visible(t, s), false );
+
+    // without the wall
+    vm.edit_dtm(wall, 0, wall + 1, height, [](size_t, size_t, float& z, float&) {
+        z = 0;
+    });
+    BOOST_CHECK_EQUAL( vm.is_visible(s, t), true );
+}
+
+BOOST_AUTO_TEST_CASE( test_visibility_hierarchical )
+{
+    std::string dtm_path = "/tmp/test_visibility_hierarchical.tif";
+    std::string robotm_path = "/tmp/robot.json";
+
+    // hills, a few spikes and unknown cells
+    const size_t width = 257, height = 190;
+    gdalwrap::gdal dtm;
+    dtm.set_size(2, width, height);
+    dtm.names = {"Z_MAX", "N_POINTS"};
+    for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+        size_t pos = x + y * width;
+        dtm.bands[0][pos] = 3 * std::sin(x * 0.05) * std::cos(y * 0.04);
+        if (pos % 997 == 0)
+            dtm.bands[0][pos] += 10;
+        dtm.bands[1][pos] = (pos * 7919 % 23) ? 3 : 0;
+    }
+    dtm.save(dtm_path);
+
+    gladys::visibility_map vm;
+    vm.load(dtm_path, robotm_path);
+    BOOST_REQUIRE( vm.get_pyramid().size() > 0 );
+
+    std::srand(43);
+    size_t n_visible = 0, mismatch = 0;
+    for (size_t i = 0; i < 2000; i++) {
+        gladys::point_xyz_t s = {double(std::rand() % width),
+            double(std::rand() % height), 0.5 + (std::rand() % 40) * 0.1};
+        gladys::point_xyz_t t = {double(std::rand() % width),
+            double(std::rand() % height), 0};
+        bool expected = reference_is_visible(vm, s, t);
+        if (vm.is_visible(s, t) != expected)
+            mismatch++;
+        if (expected)
+            n_visible++;
+    }
+    BOOST_TEST_MESSAGE( "hierarchical " << n_visible << " visible of 2000" );
+    BOOST_CHECK( n_visible > 100 );
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+
+    // raise a wall, the pyramid is refreshed around it
+    vm.edit_dtm(128, 0, 129, height, [](size_t, size_t, float& z, float&) {
+        z = 20;
+    });
+    gladys::point_xyz_t s = {20, 100, 1}, t = {240, 90, 0};
+    BOOST_CHECK_EQUAL( reference_is_visible(vm, s, t), false );
+    BOOST_CHECK_EQUAL( vm.is_visible(s, t), false );
+}
+
+BOOST_AUTO_TEST_CASE( test_packed_dtm )
+{
+    std::string dtm_path = "/tmp/test_packed_dtm.tif";
+    std::string saved_path = "/tmp/test_packed_dtm_saved.tif";
+    std::string robotm_path = "/tmp/robot.json";
+
+    // not a multiple of the Morton blocks
+    const size_t width = 83, height = 41;
+    gdalwrap::gdal dtm;
+    dtm.set_size(2, width, height);
+    dtm.names = {"Z_MAX", "N_POINTS"};
+    for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+        size_t pos = x + y * width;
+        dtm.bands[0][pos] = 2 * std::sin(x * 0.2) + (pos % 89 == 0 ? 8 : 0);
+        dtm.bands[1][pos] = (pos % 13) ? 2 : 0;
+    }
+    dtm.save(dtm_path);
+
+    // every cell at its own position, in both layouts
+    for (bool morton : {false, true}) {
+        gladys::packed_dtm cells;
+        cells.pack(dtm.bands[0], dtm.bands[1], width, height, morton);
+        BOOST_CHECK_EQUAL( cells.is_morton(), morton );
+        std::vector<bool> used(((width + 15) / 16 * 16) * ((height + 15) / 16 * 16));
+        size_t mismatch = 0, collision = 0;
+        for (size_t y = 0; y < height; y++)
+        for (size_t x = 0; x < width; x++) {
+            size_t pos = cells.pos(x, y);
+            if (used[pos])
+                collision++;
+            used[pos] = true;
+            if (cells(x, y).z_max != dtm.bands[0][x + y * width] or
+                cells(x, y).n_points != dtm.bands[1][x + y * width])
+                mismatch++;
+        }
+        BOOST_CHECK_EQUAL( collision, 0 );
+        BOOST_CHECK_EQUAL( mismatch, 0 );
+    }
+
+    gladys::visibility_map vm;
+    vm.load(dtm_path, robotm_path);
+    BOOST_CHECK( !vm.is_morton() );
+    std::srand(45);
+    std::vector<gladys::point_xyz_t> sensors, targets;
+    for (size_t i = 0; i < 1000; i++) {
+        sensors.push_back({double(std::rand() % width),
+            double(std::rand() % height), 0.5 + (std::rand() % 30) * 0.1});
+        targets.push_back({double(std::rand() % width),
+            double(std::rand() % height), 0});
+    }
+    std::vector<bool> row_major;
+    size_t mismatch = 0;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        row_major.push_back(vm.is_visible(sensors[i], targets[i]));
+        if (row_major.back() != reference_is_visible(vm, sensors[i], targets[i]))
+            mismatch++;
+    }
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+
+    vm.pack(true);
+    BOOST_CHECK( vm.is_morton() );
+    mismatch = 0;
+    for (size_t i = 0; i < sensors.size(); i++)
+        if (vm.is_visible(sensors[i], targets[i]) != row_major[i])
+            mismatch++;
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+    gladys::point_xy_t s = {10, 20};
+    BOOST_CHECK( vm.viewshed(s) == gladys::visibility_map(dtm_path,
+                                        robotm_path).viewshed(s) );
+
+    // edits reach the packed cells, the bands are still saved
+    vm.edit_dtm(40, 0, 41, height, [](size_t, size_t, float& z, float&) {
+        z = 30;
+    });
+    gladys::point_xyz_t s3 = {5, 21, 1}, t3 = {75, 20, 0};
+    BOOST_CHECK_EQUAL( reference_is_visible(vm, s3, t3), false );
+    BOOST_CHECK_EQUAL( vm.is_visible(s3, t3), false );
+    vm.save(saved_path);
+    gladys::visibility_map saved(saved_path, robotm_path);
+    BOOST_CHECK( !saved.is_morton() );
+    BOOST_CHECK_EQUAL( saved.get_heightmap()[40 + 3 * width], 30 );
+    BOOST_CHECK_EQUAL( saved.is_visible(s3, t3), false );
+}
+
+BOOST_AUTO_TEST_CASE( test_los_kernel )
+{
+    gladys::los_kernel_t scalar = gladys::get_los_kernel("scalar");
+    BOOST_REQUIRE( scalar != NULL );
+    BOOST_REQUIRE( gladys::get_los_kernel() != NULL );
+    BOOST_TEST_MESSAGE( "los kernel: " << gladys::get_los_kernel_name() );
+
+    std::srand(44);
+    for (const char* name : {"sse2", "avx2"}) {
+        gladys::los_kernel_t kernel = gladys::get_los_kernel(name);
+        if (kernel == NULL)
+            continue;
+        size_t mismatch = 0, hits = 0;
+        for (size_t trial = 0; trial < 20000; trial++) {
+            gladys::los_batch batch;
+            batch.count = 1 + std::rand() % gladys::los_batch::size;
+            for (size_t i = 0; i < gladys::los_batch::size; i++) {
+                batch.dx[i] = (std::rand() % 2001 - 1000) * 0.013;
+                batch.dy[i] = (std::rand() % 2001 - 1000) * 0.017;
+                batch.z[i] = (std::rand() % 400) * 0.01f;
+                batch.n[i] = std::rand() % 4 ? 3 : 0.95f;
+            }
+            double a = (std::rand() % 200 - 100) * 0.001;
+            double zs = (std::rand() % 400) * 0.01;
+            // on the boundary: a*d + z - zs = EPS, and at the sensor
+            if (trial % 7 == 0) {
+                double d = std::sqrt(batch.dx[0] * batch.dx[0] + batch.dy[0] * batch.dy[0]);
+                a = (0.05 + zs - batch.z[0]) / d;
+            }
+            if (trial % 11 == 0)
+                batch.dx[1] = batch.dy[1] = 0;
+            bool expected = scalar(batch, zs, a, 0.95, 0.05);
+            if (kernel(batch, zs, a, 0.95, 0.05) != expected)
+                mismatch++;
+            if (expected)
+                hits++;
+        }
+        BOOST_TEST_MESSAGE( name << ": " << hits << " occluded batches" );
+        BOOST_CHECK( hits > 1000 );
+        BOOST_CHECK_EQUAL( mismatch, 0 );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_horizons )
+{
+    std::string dtm_path = "/tmp/test_horizons.tif";
+    std::string horizons_path = "/tmp/test_horizons_map.tif";
+    std::string robotm_path = "/tmp/robot_antenna.json";
+
+    std::ofstream robot_cfg(robotm_path);
+    robot_cfg
+        << "{"
+            << "\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0},"
+            << "\"sensor\":{\"range\":20.0,\"fov\":6.28,"
+                <<   "\"pose\":{\"x\":0.1,\"y\":0.2,\"z\":0.7,\"t\":0.0}},"
+            << "\"antenna\":{\"range\":12.0,\"fov\":6.28,"
+                <<   "\"pose\":{\"x\":0.0,\"y\":0.0,\"z\":1.5,\"t\":0.0}}"
+        << "}" ;
+    robot_cfg.close();
+
+    // gentle hills, rare spikes and unknown cells
+    make_hills(1999, true).save(dtm_path);
+
+    std::srand(47);
+    std::vector<gladys::point_xy_t> antennas, targets;
+    for (size_t i = 0; i < 3000; i++) {
+        antennas.push_back({(std::rand() % 880) * 0.05, (std::rand() % 680) * 0.05});
+        targets.push_back({(std::rand() % 880) * 0.05, (std::rand() % 680) * 0.05});
+    }
+
+    // by default, one ring and the upper map: certified links only, the
+    // others are tested, approximate or not
+    gladys::visibility_map vm(dtm_path, robotm_path);
+    vm.build_horizons();
+    BOOST_REQUIRE_EQUAL( vm.get_horizons().get_sectors(), 32 );
+    BOOST_REQUIRE_EQUAL( vm.get_horizons().get_rings(), 1 );
+    BOOST_CHECK( !vm.get_horizons().has_lower() );
+    size_t n_visible = 0, mismatch = 0;
+    for (size_t i = 0; i < antennas.size(); i++) {
+        bool expected = vm.is_antenna_visible(antennas[i], targets[i]);
+        n_visible += expected;
+        mismatch += vm.is_antenna_visible_approx(antennas[i], targets[i]) != expected;
+        mismatch += vm.is_antenna_visible_approx(antennas[i], targets[i], false) != expected;
+    }
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+
+    vm.build_horizons(32, 4, true);
+    BOOST_REQUIRE_EQUAL( vm.get_horizons().get_rings(), 4 );
+    BOOST_CHECK( vm.get_horizons().has_lower() );
+    size_t mismatch_conservative = 0;
+    mismatch = 0;
+    for (size_t i = 0; i < antennas.size(); i++) {
+        bool expected = vm.is_antenna_visible(antennas[i], targets[i]);
+        bool approx = vm.is_antenna_visible_approx(antennas[i], targets[i], false);
+        bool conservative = vm.is_antenna_visible_approx(antennas[i], targets[i]);
+        mismatch += approx != expected;
+        mismatch_conservative += conservative != expected;
+    }
+    BOOST_TEST_MESSAGE( "horizons: " << n_visible << " visible, "
+        << mismatch << " approximate mismatches" );
+    // conservative: only the upper horizon answers, and it is a bound
+    BOOST_CHECK_EQUAL( mismatch_conservative, 0 );
+    BOOST_CHECK( mismatch < antennas.size() / 10 );
+
+    // saved next to the dtm
+    vm.save_horizons(horizons_path);
+    gladys::visibility_map loaded(dtm_path, robotm_path);
+    loaded.load_horizons(horizons_path);
+    mismatch = 0;
+    for (size_t i = 0; i < antennas.size(); i++)
+        if (loaded.is_antenna_visible_approx(antennas[i], targets[i], false) !=
+            vm.is_antenna_visible_approx(antennas[i], targets[i], false))
+            mismatch++;
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+    BOOST_CHECK( loaded.get_horizons().has_lower() );
+    BOOST_CHECK_THROW( loaded.load_horizons(dtm_path), std::runtime_error );
+
+    // an edit drops the horizons, the exact test answers again
+    loaded.set_cell(45, 35, 10, 3);
+    BOOST_CHECK( loaded.get_horizons().empty() );
+    for (size_t i = 0; i < 100; i++)
+        BOOST_CHECK_EQUAL( loaded.is_antenna_visible_approx(antennas[i], targets[i]),
+                           loaded.is_antenna_visible(antennas[i], targets[i]) );
+}
+
+BOOST_AUTO_TEST_CASE( test_visibility_cache )
+{
+    std::string dtm_path = "/tmp/test_visibility_cache.tif";
+    std::string robotm_path = "/tmp/robot_cache.json";
+
+    std::ofstream robot_cfg(robotm_path);
+    robot_cfg
+        << "{"
+            << "\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0},"
+            << "\"antenna\":{\"range\":20.0,\"fov\":6.28,"
+                <<   "\"pose\":{\"x\":0.3,\"y\":0.0,\"z\":0.6,\"t\":0.0}}"
+        << "}" ;
+    robot_cfg.close();
+
+    // gentle hills and spikes
+    gdalwrap::gdal dtm = make_hills(499, false);
+    const size_t width = dtm.get_width(), height = dtm.get_height();
+    dtm.save(dtm_path);
+
+    gladys::visibility_map vm(dtm_path, robotm_path);
+    const gladys::pixel_transform pixels = vm.get_pixel_transform();
+    auto center = [&](const gladys::pixel_t& px, double z) {
+        gladys::point_xy_t p = pixels.pix2custom(px[0], px[1]);
+        return gladys::point_xyz_t{{p[0], p[1], z}};
+    };
+
+    // cell pairs, the queries cached
+    std::srand(50);
+    std::vector<gladys::pixel_t> sensors, targets;
+    for (size_t i = 0; i < 2000; i++) {
+        sensors.push_back({{long(std::rand() % width), long(std::rand() % height)}});
+        targets.push_back({{long(std::rand() % width), long(std::rand() % height)}});
+    }
+    // both ways: the test is not symmetric, nor its cached answers
+    std::vector<bool> expected, expected_back;
+    size_t n_visible = 0, n_one_way = 0, mismatch = 0;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        expected.push_back(vm.is_visible_cell(sensors[i], 0.7, targets[i], 0.2));
+        expected_back.push_back(vm.is_visible_cell(targets[i], 0.2, sensors[i], 0.7));
+        n_visible += expected[i];
+        n_one_way += expected[i] != expected_back[i];
+        // is_visible between the centers
+        mismatch += expected[i] != vm.is_visible(center(sensors[i], 0.7),
+                                                 center(targets[i], 0.2));
+    }
+
+    vm.enable_cache(10000);
+    for (size_t pass = 0; pass < 2; pass++)
+        for (size_t i = 0; i < sensors.size(); i++) {
+            mismatch += vm.is_visible_cell(sensors[i], 0.7, targets[i], 0.2) != expected[i];
+            mismatch += vm.is_visible_cell(targets[i], 0.2, sensors[i], 0.7) != expected_back[i];
+            // the heights are snapped to the centimetre, the same key
+            mismatch += vm.is_visible_cell(sensors[i], 0.7013, targets[i], 0.1987) != expected[i];
+        }
+    BOOST_TEST_MESSAGE( "cache: " << n_visible << " visible, "
+                        << n_one_way << " one way" );
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+    BOOST_CHECK( n_one_way > 0 );
+    BOOST_CHECK_THROW( vm.is_visible_cell({{long(width), 0}}, 0.7, targets[0], 0.2),
+                       std::out_of_range );
+
+    // links, tested both ways: one entry for (a, b) and (b, a)
+    size_t n_links = 0;
+    mismatch = 0;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        gladys::point_xy_t a = pixels.pix2custom(sensors[i][0], sensors[i][1]);
+        gladys::point_xy_t b = pixels.pix2custom(targets[i][0], targets[i][1]);
+        bool linked = vm.is_antenna_visible(a, b) and vm.is_antenna_visible(b, a);
+        mismatch += vm.is_antenna_link_cell(sensors[i], targets[i]) != linked;
+        mismatch += vm.is_antenna_link_cell(targets[i], sensors[i]) != linked;
+        n_links += linked;
+    }
+    BOOST_TEST_MESSAGE( "cache: " << n_links << " links" );
+    BOOST_CHECK( n_links > 0 );
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+
+    // a wall between s and t: the answers of the previous dtm are dropped
+    gladys::pixel_t s = {{10, 10}}, t = {{60, 50}};
+    BOOST_REQUIRE( vm.is_visible_cell(s, 0.5, t, 0.5) );
+    for (size_t y = 0; y < height; y++)
+        vm.set_cell(40, y, 10, 3);
+    BOOST_CHECK( !vm.is_visible_cell(s, 0.5, t, 0.5) );
+    BOOST_CHECK( !vm.is_visible_cell(t, 0.5, s, 0.5) );
+
+    vm.disable_cache();
+    BOOST_CHECK( !vm.is_visible_cell(s, 0.5, t, 0.5) );
+    BOOST_CHECK_THROW( vm.enable_cache(0), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( test_robot_params )
+{
+    std::string robotm_path = "/tmp/robot_params.json";
+    std::ofstream robot_cfg(robotm_path);
+    robot_cfg
+        << "{"
+            << "\"robot\":{\"mass\":1.0,\"radius\":0.5,\"velocity\":1.0},"
+            << "\"sensor\":{\"range\":20.0,\"fov\":6.28,"
+                <<   "\"pose\":{\"x\":0.1,\"y\":0.2,\"z\":0.7,\"t\":0.0}"
+            << "}"
+        << "}" ;
+    robot_cfg.close();
+
+    gladys::robot_model rmdl;
+    BOOST_CHECK_THROW( rmdl.get_radius(), std::runtime_error );
+    rmdl.load(robotm_path);
+    BOOST_CHECK_EQUAL( rmdl.get_radius(), 0.5 );
+    BOOST_CHECK_EQUAL( rmdl.get_params().sensor_range, 20.0 );
+    // no antenna: the sensor is used
+    BOOST_CHECK_EQUAL( rmdl.get_antenna_range(), 20.0 );
+    BOOST_CHECK_EQUAL( rmdl.get_antenna_pose()[2], 0.7 );
+
+    // setters update the parsed parameters
+    rmdl.set_radius(0.8);
+    rmdl.set_sensor_range(15.0);
+    BOOST_CHECK_EQUAL( rmdl.get_radius(), 0.8 );
+    BOOST_CHECK_EQUAL( rmdl.get_antenna_range(), 15.0 );
+    rmdl.set_antenna_range(30.0);
+    BOOST_CHECK_EQUAL( rmdl.get_antenna_range(), 30.0 );
+    BOOST_CHECK_EQUAL( rmdl.get_sensor_range(), 15.0 );
+    // an antenna object without a pose
+    BOOST_CHECK_THROW( rmdl.get_antenna_pose(), std::runtime_error );
+
+    // and the tree, for save
+    rmdl.save(robotm_path);
+    gladys::robot_model saved;
+    saved.load(robotm_path);
+    BOOST_CHECK_EQUAL( saved.get_radius(), 0.8 );
+    BOOST_CHECK_EQUAL( saved.get_antenna_range(), 30.0 );
 }
 
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,546 @@
+/*
+ * test_weight_map.cpp
+ *
+ * Test the Graph Library for Autonomous and Dynamic Systems
+ *
+ * author:  agent <agent@local>
+ * created: 2026-10-18
+ * license: BSD
+ */
+#define BOOST_TEST_MODULE const_string test
+#include <boost/test/included/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdlib>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+#include "gdalwrap/gdal.hpp"
+#include "gladys/weight_map.hpp"
+#include "gladys/mapped_raster.hpp"
+#include "gladys/nav_graph.hpp"
+
+BOOST_AUTO_TEST_SUITE( weight_map )
+
+// odd sizes, to go through the vectorised and the scalar tail paths
+static const size_t width = 131, height = 67;
+
+static float random_proba() {
+    return std::rand() / (float) RAND_MAX;
+}
+
+static const std::string basic_robot =
+    "{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0}}";
+
+static void write_robot(const std::string& path, const std::string& cfg) {
+    std::ofstream robot_cfg(path);
+    robot_cfg<<cfg;
+    robot_cfg.close();
+}
+
+/** a robot model and a width x height region, the case fills and saves it */
+struct region_fixture {
+    std::string region_path, robotm_path;
+    gdalwrap::gdal region;
+
+    region_fixture(const std::string& name,
+                   const std::string& robot_cfg = basic_robot,
+                   const std::vector<std::string>& names =
+                       {"NO_3D_CLASS", "FLAT", "OBSTACLE", "ROUGH"}) :
+        region_path("/tmp/test_weight_map_" + name + ".tif"),
+        robotm_path("/tmp/test_weight_map_" + name + "_robot.json") {
+        write_robot(robotm_path, robot_cfg);
+        region.set_size(names.size(), width, height);
+        region.names = names;
+    }
+
+    /** every band random */
+    void randomize(unsigned seed) {
+        std::srand(seed);
+        for (auto& band : region.bands)
+            for (auto& value : band)
+                value = random_proba();
+    }
+    void save() {
+        region.save(region_path);
+    }
+};
+
+BOOST_AUTO_TEST_CASE( test_weight_map_load )
+{
+    region_fixture world("load",
+        "{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.3}}");
+    gdalwrap::gdal& region = world.region;
+    world.randomize(42);
+    // values right on the thresholds
+    region.bands[0][7] = 0.9;
+    region.bands[2][8] = 0.4;
+    world.save();
+
+    gladys::weight_map wm(world.region_path, world.robotm_path);
+    const gdalwrap::raster& weights = wm.get_weight_band();
+    BOOST_REQUIRE_EQUAL( weights.size(), width * height );
+
+    // reference: the per-pixel formula
+    double velocity = wm.get_robot().get_velocity();
+    std::map<std::string, float> costs = wm.get_robot().get_costs();
+    size_t mismatch = 0;
+    for (size_t pos = 0; pos < width * height; pos++) {
+        float expected;
+        if (region.get_band("NO_3D_CLASS")[pos] > 0.9)
+            expected = -1;
+        else if (region.get_band("OBSTACLE")[pos] > 0.4)
+            expected = std::numeric_limits<float>::infinity();
+        else {
+            float weight = 1.0;
+            for (const auto& kv : costs)
+                weight += kv.second * region.get_band(kv.first)[pos];
+            expected = weight / velocity;
+        }
+        if (weights[pos] != expected)
+            mismatch++;
+    }
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_costmap_load )
+{
+    // costs and precision bands, not named
+    region_fixture world("costmap",
+        "{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":0.7}}",
+        {"", ""});
+    gdalwrap::gdal& region = world.region;
+    std::srand(43);
+    for (auto& value : region.bands[0])
+        value = std::floor(random_proba() * 256);
+    for (auto& value : region.bands[1])
+        value = std::floor(random_proba() * 200);
+    world.save();
+
+    gladys::costmap cm(world.region_path, world.robotm_path);
+    const gdalwrap::raster& weights = cm.get_weight_band();
+    BOOST_REQUIRE_EQUAL( weights.size(), width * height );
+
+    double velocity = cm.get_robot().get_velocity();
+    size_t mismatch = 0;
+    for (size_t pos = 0; pos < width * height; pos++) {
+        float expected;
+        if (region.bands[1][pos] < 100)
+            expected = -1;
+        else if (region.bands[0][pos] > 252)
+            expected = std::numeric_limits<float>::infinity();
+        else
+            expected = 1 + region.bands[0][pos] / velocity;
+        if (weights[pos] != expected)
+            mismatch++;
+    }
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_cost_model )
+{
+    region_fixture world("cost_model",
+        "{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":2.0},"
+        "\"costs\":{\"ROUGH\":2.3,\"SLOPE\":3.7},"
+        "\"obstacle\":{\"class\":\"OBSTACLE\",\"threshold\":0.7}}",
+        {"SLOPE", "NO_3D_CLASS", "FLAT", "OBSTACLE", "ROUGH"});
+    gdalwrap::gdal& region = world.region;
+    const std::string& region_path = world.region_path;
+    const std::string& robot1_path = world.robotm_path;
+    std::string robot2_path = "/tmp/test_weight_map_cost_model_robot2.json";
+    write_robot(robot2_path,
+        "{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0},"
+        "\"costs\":{\"FLAT\":0.5,\"SLOPE\":1.0}}");
+    world.randomize(45);
+    world.save();
+
+    gladys::robot_model robot1, robot2;
+    robot1.load(robot1_path);
+    robot2.load(robot2_path);
+    BOOST_CHECK_EQUAL( robot1.get_costs().size(), 2 );
+    BOOST_CHECK_EQUAL( robot1.get_obstacle_threshold(), 0.7 );
+    BOOST_CHECK_EQUAL( robot1.get_unknown_threshold(), 0.9 );
+
+    gladys::cost_model model = robot1.compile_costs(region.names);
+    BOOST_REQUIRE_EQUAL( model.coefs.size(), 5 );
+    BOOST_CHECK_EQUAL( model.coefs[0], 3.7f );
+    BOOST_CHECK_EQUAL( model.coefs[2], 0.0 );
+    BOOST_CHECK_EQUAL( model.coefs[4], 2.3f );
+    BOOST_CHECK_EQUAL( model.obstacle_band, 3 );
+    BOOST_CHECK_EQUAL( model.unknown_band, 1 );
+
+    // unknown class in the cost model
+    gladys::robot_model robot3 = robot1;
+    robot3.set_cost("SAND", 1.0);
+    BOOST_CHECK_THROW( robot3.compile_costs(region.names), std::runtime_error );
+
+    gladys::weight_map wm(region_path, robot1_path);
+    size_t mismatch = 0;
+    for (size_t pos = 0; pos < width * height; pos++) {
+        float expected;
+        if (region.bands[1][pos] > 0.9)
+            expected = -1;
+        else if (region.bands[3][pos] > 0.7)
+            expected = std::numeric_limits<float>::infinity();
+        else {
+            // summed in the order of the cost names (ROUGH, SLOPE), not
+            // in the band order: a float sum depends on its order
+            float weight = 1.0;
+            weight += 2.3f * region.bands[4][pos];
+            weight += 3.7f * region.bands[0][pos];
+            expected = weight / 2.0;
+        }
+        if (wm.get_weight_band()[pos] != expected)
+            mismatch++;
+    }
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+
+    // switching robot re-blends the same terrains
+    wm.set_robot(robot2);
+    gladys::weight_map wm2(region_path, robot2_path);
+    BOOST_CHECK( wm.get_weight_band() == wm2.get_weight_band() );
+}
+
+BOOST_AUTO_TEST_CASE( test_make_weight_maps )
+{
+    region_fixture world("multi");
+    const std::string& region_path = world.region_path;
+    std::vector<std::string> robot_paths = {
+        "/tmp/test_weight_map_rover.json",
+        "/tmp/test_weight_map_ugv.json",
+        "/tmp/test_weight_map_walker.json" };
+    std::vector<std::string> robot_cfgs = {
+        "{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.0}}",
+        "{\"robot\":{\"mass\":1.0,\"radius\":2.0,\"velocity\":0.5,"
+        "\"inflate\":true},\"costs\":{\"ROUGH\":9.0}}",
+        "{\"robot\":{\"mass\":1.0,\"radius\":0.5,\"velocity\":0.3},"
+        "\"costs\":{\"FLAT\":1.0,\"ROUGH\":1.0}}" };
+
+    world.randomize(46);
+    world.save();
+
+    std::vector<gladys::robot_model> robots(robot_paths.size());
+    for (size_t i = 0; i < robot_paths.size(); i++) {
+        write_robot(robot_paths[i], robot_cfgs[i]);
+        robots[i].load(robot_paths[i]);
+    }
+
+    std::vector<gladys::weight_map> maps =
+        gladys::make_weight_maps(region_path, robots);
+    BOOST_REQUIRE_EQUAL( maps.size(), robots.size() );
+    for (size_t i = 0; i < robots.size(); i++) {
+        gladys::weight_map wm(region_path, robot_paths[i]);
+        BOOST_CHECK( maps[i].get_weight_band() == wm.get_weight_band() );
+        // terrains are shared, not copied
+        BOOST_CHECK_EQUAL( &maps[i].get_region(), &maps[0].get_region() );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_load_streamed )
+{
+    region_fixture world("streamed",
+        "{\"robot\":{\"mass\":1.0,\"radius\":1.0,\"velocity\":1.3},"
+        "\"costs\":{\"ROUGH\":4.0}}",
+        {"NO_3D_CLASS", "FLAT", "OBSTACLE", "ROUGH", "SLOPE"});
+    world.region.set_transform(10, 20, 0.5, -0.5);
+    world.region.set_custom_origin(2, 3);
+    world.randomize(47);
+    world.save();
+
+    gladys::weight_map wm(world.region_path, world.robotm_path);
+    gladys::weight_map wm_streamed;
+    wm_streamed.load_streamed(world.region_path, world.robotm_path);
+    BOOST_CHECK( wm_streamed.get_weight_band() == wm.get_weight_band() );
+    BOOST_CHECK_EQUAL( wm_streamed.get_width(), width );
+    BOOST_CHECK_EQUAL( wm_streamed.get_height(), height );
+    BOOST_CHECK_EQUAL( wm_streamed.get_scale_y(), -0.5 );
+    BOOST_CHECK_EQUAL( wm_streamed.get_utm_pose_x(), 10 );
+    gladys::point_xy_t p = {9, 7};
+    BOOST_CHECK_EQUAL( wm_streamed.index(p), wm.index(p) );
+}
+
+BOOST_AUTO_TEST_CASE( test_load_mapped )
+{
+    region_fixture world("mapped_region");
+    gdalwrap::gdal& region = world.region;
+    const std::string& region_path = world.region_path;
+    std::string tiles_path = "/tmp/test_weight_map_mapped.tiles";
+    region.set_transform(10, 20, 0.5, -0.5);
+    region.set_custom_origin(2, 3);
+    world.randomize(48);
+    world.save();
+
+    gladys::weight_map wm(region_path, world.robotm_path);
+    wm.save_mapped(tiles_path);
+
+    gladys::weight_map wm_mapped;
+    wm_mapped.load_mapped(tiles_path);
+    BOOST_CHECK_EQUAL( wm_mapped.get_width(), width );
+    BOOST_CHECK_EQUAL( wm_mapped.get_height(), height );
+    BOOST_CHECK_EQUAL( wm_mapped.get_scale_x(), 0.5 );
+    BOOST_CHECK_EQUAL( wm_mapped.get_utm_pose_y(), 20 );
+    BOOST_CHECK_THROW( wm_mapped.get_weight_band(), std::runtime_error );
+    size_t mismatch = 0;
+    for (size_t pos = 0; pos < width * height; pos++)
+        if (wm_mapped.get_weight(pos) != wm.get_weight_band()[pos] or
+            wm_mapped.get_weight(pos % width, pos / width) != wm.get_weight_band()[pos])
+            mismatch++;
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+    gladys::point_xy_t p = {9, 7};
+    BOOST_CHECK_EQUAL( wm_mapped.index(p), wm.index(p) );
+    BOOST_CHECK( wm_mapped.get_weight_band_uchar() == wm.get_weight_band_uchar() );
+
+    BOOST_CHECK_THROW( wm_mapped.load_mapped(region_path), std::runtime_error );
+
+    // the utm zone and hemisphere are kept
+    region.set_utm(31, false);
+    gladys::mapped_raster::save(region, {"FLAT"}, tiles_path);
+    gladys::mapped_raster tiles(tiles_path);
+    BOOST_CHECK_EQUAL( tiles.get_meta().get_utm_zone(), 31 );
+    BOOST_CHECK( !tiles.get_meta().is_utm_north() );
+    BOOST_CHECK_EQUAL( tiles.get_meta().get_custom_y_origin(), 3 );
+}
+
+BOOST_AUTO_TEST_CASE( test_quantize )
+{
+    region_fixture world("quantize");
+    gdalwrap::gdal& region = world.region;
+    const std::string& region_path = world.region_path;
+    const std::string& robotm_path = world.robotm_path;
+
+    // a few hundred cost levels
+    std::srand(49);
+    for (size_t pos = 0; pos < width * height; pos++) {
+        region.bands[0][pos] = std::rand() % 20 == 0;
+        region.bands[2][pos] = std::rand() % 20 == 0;
+        region.bands[3][pos] = (std::rand() % 200) / 200.0;
+    }
+    world.save();
+
+    gladys::weight_map wm(region_path, robotm_path);
+    gladys::weight_map wm8(region_path, robotm_path);
+    wm8.quantize(8);
+    BOOST_REQUIRE( wm8.get_quantized() != NULL );
+    BOOST_CHECK( wm8.get_quantized()->is_lossless() );
+    BOOST_CHECK_THROW( wm8.get_weight_band(), std::runtime_error );
+    size_t mismatch = 0;
+    for (size_t pos = 0; pos < width * height; pos++)
+        if (wm8.get_weight(pos) != wm.get_weight_band()[pos])
+            mismatch++;
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+
+    // graphs built from the decoded weights: same costs
+    gladys::nav_graph ng(wm), ng8(wm8);
+    gladys::point_xy_t start = {2, 3}, goal = {120, 60};
+    BOOST_CHECK_EQUAL(
+        ng.astar_search(gladys::points_t({start}), gladys::points_t({goal})).cost,
+        ng8.astar_search(gladys::points_t({start}), gladys::points_t({goal})).cost );
+
+    // more distinct weights than codes: bounded relative error
+    for (auto& value : region.bands[3])
+        value = random_proba();
+    region.save(region_path);
+    gladys::weight_map wm_lossy(region_path, robotm_path);
+    gdalwrap::raster reference = wm_lossy.get_weight_band();
+    wm_lossy.quantize(8);
+    BOOST_CHECK( not wm_lossy.get_quantized()->is_lossless() );
+    double max_error = 0;
+    for (size_t pos = 0; pos < width * height; pos++) {
+        float weight = wm_lossy.get_weight(pos);
+        if (reference[pos] <= 0 or std::isinf(reference[pos]))
+            BOOST_CHECK_EQUAL( weight, reference[pos] );
+        else
+            max_error = std::max(max_error,
+                double(std::abs(weight - reference[pos]) / reference[pos]));
+    }
+    BOOST_CHECK_LT( max_error, 0.01 );
+    // 16 bits: lossless here
+    gladys::weight_map wm16(region_path, robotm_path);
+    wm16.quantize(16);
+    BOOST_CHECK( wm16.get_quantized()->is_lossless() );
+    BOOST_CHECK( wm16.get_decoded_map().bands[0] == reference );
+}
+
+BOOST_AUTO_TEST_CASE( test_inflate_obstacles )
+{
+    region_fixture world("inflate",
+        "{\"robot\":{\"mass\":1.0,\"radius\":1.1,\"velocity\":1.0,"
+        "\"inflate\":true,\"inflation_falloff\":0.8}}");
+    gdalwrap::gdal& region = world.region;
+
+    // few obstacles, a few unknown cells, anisotropic scale
+    const size_t w = 41, h = 29;
+    const double sx = 0.5, sy = -0.3;
+    std::srand(44);
+    region.set_size(4, w, h);
+    region.set_transform(100, 200, sx, sy);
+    region.bands[1].assign(w * h, 1);
+    for (size_t pos = 0; pos < w * h; pos++) {
+        if (std::rand() % 50 == 0)
+            region.bands[2][pos] = 1;
+        else if (std::rand() % 50 == 0)
+            region.bands[0][pos] = 1;
+    }
+    world.save();
+
+    gladys::weight_map wm(world.region_path, world.robotm_path);
+    const gdalwrap::raster& weights = wm.get_weight_band();
+
+    // brute force reference
+    const float inf = std::numeric_limits<float>::infinity();
+    double radius = 1.1, outer = 1.1 + 0.8;
+    size_t mismatch = 0, inflated = 0, graded = 0;
+    for (size_t y = 0; y < h; y++)
+    for (size_t x = 0; x < w; x++) {
+        size_t pos = x + y * w;
+        float expected;
+        if (region.bands[0][pos] > 0.9)
+            expected = -1;
+        else if (region.bands[2][pos] > 0.4)
+            expected = inf;
+        else {
+            double dmin = inf;
+            for (size_t oy = 0; oy < h; oy++)
+            for (size_t ox = 0; ox < w; ox++) {
+                size_t opos = ox + oy * w;
+                if (region.bands[2][opos] > 0.4 and
+                    not (region.bands[0][opos] > 0.9)) {
+                    double dx = (double(ox) - x) * sx, dy = (double(oy) - y) * sy;
+                    dmin = std::min(dmin, std::sqrt(dx * dx + dy * dy));
+                }
+            }
+            expected = 1;
+            if (dmin <= radius) {
+                expected = inf;
+                inflated++;
+            } else if (dmin < outer) {
+                expected *= 1 + (outer - dmin) / 0.8;
+                graded++;
+            }
+        }
+        // distance transform is computed in float, allow for rounding
+        if (not (weights[pos] == expected or
+                 std::abs(weights[pos] - expected) < 1e-4))
+            mismatch++;
+    }
+    BOOST_CHECK( inflated > 0 );
+    BOOST_CHECK( graded > 0 );
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+}
+
+/** count the pyramid cells differing from the reductions of the band */
+static size_t pyramid_mismatch(const gladys::raster_pyramid& pyramid,
+                               const gdalwrap::raster& band) {
+    size_t w = pyramid.get_width(), h = pyramid.get_height(), mismatch = 0;
+    for (size_t level = 1; level <= pyramid.size(); level++) {
+        const gladys::pyramid_level& l = pyramid.get_level(level);
+        size_t side = size_t(1) << level;
+        for (size_t y = 0; y < l.height; y++)
+        for (size_t x = 0; x < l.width; x++) {
+            float vmin = std::numeric_limits<float>::infinity(), vmax = -vmin;
+            double sum = 0;
+            size_t count = 0;
+            for (size_t py = y * side; py < std::min((y + 1) * side, h); py++)
+            for (size_t px = x * side; px < std::min((x + 1) * side, w); px++) {
+                float value = band[px + py * w];
+                vmin = std::min(vmin, value);
+                vmax = std::max(vmax, value);
+                sum += value;
+                count++;
+            }
+            size_t idx = x + y * l.width;
+            double mean = sum / count;
+            if (l.min[idx] != vmin or l.max[idx] != vmax or not
+                (l.mean[idx] == mean or std::abs(l.mean[idx] - mean) < 1e-4))
+                mismatch++;
+        }
+    }
+    return mismatch;
+}
+
+BOOST_AUTO_TEST_CASE( test_pyramid )
+{
+    region_fixture world("pyramid");
+    const std::string& region_path = world.region_path;
+    const std::string& robotm_path = world.robotm_path;
+
+    // no obstacle nor unknown: means stay finite
+    std::srand(38);
+    for (auto& value : world.region.bands[3])
+        value = random_proba();
+    world.save();
+
+    gladys::weight_map wm(region_path, robotm_path);
+    const gladys::raster_pyramid& pyramid = wm.get_pyramid();
+    // 131 x 67 halves down to 1 x 1 in 8 levels
+    BOOST_REQUIRE_EQUAL( pyramid.size(), 8 );
+    BOOST_CHECK_EQUAL( pyramid.get_level(1).width, 66 );
+    BOOST_CHECK_EQUAL( pyramid.get_level(1).height, 34 );
+    BOOST_CHECK_EQUAL( pyramid.get_level(8).width, 1 );
+    BOOST_CHECK_EQUAL( pyramid.get_level(8).height, 1 );
+    BOOST_CHECK_THROW( pyramid.get_level(9), std::out_of_range );
+    BOOST_CHECK_EQUAL( pyramid_mismatch(pyramid, wm.get_weight_band()), 0 );
+
+    // edit a region, only its overviews are recomputed
+    gdalwrap::raster& weights = wm.get_map().bands[0];
+    for (size_t y = 20; y < 31; y++)
+    for (size_t x = 45; x < 60; x++)
+        weights[x + y * width] = std::numeric_limits<float>::infinity();
+    weights[130 + 66 * width] = -1;
+    wm.update_pyramid(45, 20, 60, 31);
+    wm.update_pyramid(130, 66, 131, 67);
+    BOOST_CHECK_EQUAL( pyramid_mismatch(wm.get_pyramid(), weights), 0 );
+    BOOST_CHECK( wm.get_pyramid().get_level(8).max[0] ==
+                 std::numeric_limits<float>::infinity() );
+    BOOST_CHECK_EQUAL( wm.get_pyramid().get_level(8).min[0], -1 );
+
+    // display a level, obstacles kept
+    std::vector<unsigned char> overview = wm.get_weight_band_uchar(3);
+    BOOST_CHECK_EQUAL( overview.size(), 17 * 9 );
+    BOOST_CHECK_EQUAL( overview[48 / 8 + 24 / 8 * 17], 255 );
+
+    // quantized band: same pyramid
+    gladys::weight_map wm8(region_path, robotm_path);
+    gdalwrap::raster reference = wm8.get_weight_band();
+    wm8.quantize(16);
+    BOOST_CHECK_EQUAL( pyramid_mismatch(wm8.get_pyramid(), reference), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( test_pixel_transform )
+{
+    gladys::weight_map wm;
+    gdalwrap::raster& band = wm.setup_weight_band(width, height);
+    for (size_t idx = 0; idx < band.size(); idx++)
+        band[idx] = idx;
+    wm.get_map().set_transform(100, 200, 0.5, -0.25);
+    wm.get_map().set_custom_origin(101, 190);
+
+    const gladys::pixel_transform pixels = wm.get_pixel_transform();
+    std::srand(46);
+    size_t mismatch = 0;
+    for (size_t i = 0; i < 5000; i++) {
+        gladys::point_xy_t p = {(std::rand() % 6500) * 0.01 - 1,
+                                (std::rand() % 1650) * 0.01 - 6.6};
+        gladys::pixel_t px = wm.pixel(p);
+        if (!pixels.contains(px))
+            continue;
+        if (wm.index_pix(px) != wm.index(p))
+            mismatch++;
+        gladys::point_xy_t utm = {p[0] + 101, p[1] + 190};
+        if (wm.index_pix(wm.pixel_utm(utm)) != wm.index_utm(utm))
+            mismatch++;
+        // back to the pixel center
+        gladys::point_xy_t c = pixels.pix2custom(px[0], px[1]);
+        if (wm.get_weight(wm.index_pix(wm.pixel(c))) != wm.get_weight(wm.index(c)))
+            mismatch++;
+    }
+    BOOST_CHECK_EQUAL( mismatch, 0 );
+    BOOST_CHECK( pixels.contains(gladys::pixel_t{{0, 0}}) );
+    BOOST_CHECK( !pixels.contains(gladys::pixel_t{{-1, 0}}) );
+    BOOST_CHECK( !pixels.contains(gladys::pixel_t{{long(width), 0}}) );
+}
+
+BOOST_AUTO_TEST_SUITE_END();